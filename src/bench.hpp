@@ -0,0 +1,563 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <malloc.h>
+
+#include <SFML/Graphics/RenderTexture.hpp>
+
+#include "drone.hpp"
+#include "ea.hpp"
+#include "easyea.hpp"
+#include "history.hpp"
+#include "loader.hpp"
+#include "net.hpp"
+#include "nsga.hpp"
+#include "renderer.hpp"
+#include "reward.hpp"
+#include "runner.hpp"
+#include "utils.hpp"
+
+// Benchmarks runnable from the binary - ./Drone bench <name> [args]
+struct Bench {
+	using Clock = std::chrono::steady_clock;
+
+	static double seconds(const Clock::time_point &since) {
+		return std::chrono::duration<double>(Clock::now() - since).count();
+	}
+
+	// runs `generations` generations of a fresh EasyEA, returns the best fitness of the last one
+	static float evolve(AbstractEA &ea, const World &world, const int generations) {
+		ea.verbose = false;
+		while (ea.generation < generations) {
+			if (ea.update(dt, world, false)) {
+				ea.process();
+			}
+		}
+		return ea.lastFitnessStats.max;
+	}
+
+	// fitness vs. throughput of querying the controller only every k ticks
+	static void controlPeriod(const Net &mother, const Drone &drone, const std::vector<World> &levels, const int generations) {
+		const int runs = 3;
+
+		printf("Control period benchmark - EasyEA(128), %d generations, %d runs per setting\n", generations, runs);
+		printf("%6s %3s %10s %10s %8s %12s\n", "level", "k", "time [s]", "gen/s", "speedup", "mean BF");
+
+		for (int level = 0; level < levels.size(); ++level) {
+			// randomized levels would make the settings incomparable
+			if (!levels[level].isStatic) continue;
+
+			double baseTime = 0;
+			for (uint64_t k = 1; k <= 4; ++k) {
+				double time = 0;
+				float best = 0;
+
+				for (int run = 0; run < runs; ++run) {
+					// same seed per run -> every k starts from the same population
+					gen.seed(1000 + run);
+					EasyEA ea(128, mother, drone);
+					ea.controlPeriod = k;
+
+					auto start = Clock::now();
+					best += evolve(ea, levels[level], generations);
+					time += seconds(start);
+				}
+
+				if (k == 1) baseTime = time;
+
+				printf("%6d %3lu %10.2f %10.2f %8.2f %12.2f\n", level, k, time, runs * generations / time, baseTime / time, best / runs);
+			}
+		}
+	}
+
+	// accuracy of the batched shaping kernel against the scalar formula + throughput of both
+	static bool reward() {
+		const float tolerance = 1e-5f;
+
+		// dense grid over the whole domain of normalized goal deltas
+		const int side = 1001;
+		std::vector<float> x, y, s;
+		for (int i = 0; i < side; ++i) {
+			for (int j = 0; j < side; ++j) {
+				x.push_back(-1.0f + 2.0f * i / (side - 1));
+				y.push_back(-1.0f + 2.0f * j / (side - 1));
+				s.push_back(1 + (i + j) % 6); // goalIndex+1
+			}
+		}
+		const size_t n = x.size();
+		std::vector<float> out(n), ref(n);
+
+		float maxError = 0;
+		RewardBatch::kernel(n, x.data(), y.data(), s.data(), out.data());
+		for (size_t i = 0; i < n; ++i) {
+			ref[i] = s[i] * RewardBatch::reference(x[i], y[i]);
+			// relative to the scale, the reward of one tick is at most goalIndex+1
+			maxError = std::max(maxError, std::abs(out[i] - ref[i]) / s[i]);
+		}
+
+		const int repeats = 50;
+		auto start = Clock::now();
+		for (int r = 0; r < repeats; ++r) {
+			RewardBatch::kernel(n, x.data(), y.data(), s.data(), out.data());
+		}
+		const double kernelTime = seconds(start);
+
+		start = Clock::now();
+		for (int r = 0; r < repeats; ++r) {
+			for (size_t i = 0; i < n; ++i) {
+				ref[i] = s[i] * RewardBatch::reference(x[i], y[i]);
+			}
+		}
+		const double referenceTime = seconds(start);
+
+		const bool ok = maxError <= tolerance;
+		printf("Reward kernel benchmark - %zu deltas, %d repeats\n", n, repeats);
+		printf("max error: %.3g (tolerance %.3g) - %s\n", maxError, tolerance, ok ? "OK" : "FAILED");
+		printf("%10s %10s %12s\n", "", "time [s]", "Mdeltas/s");
+		printf("%10s %10.3f %12.1f\n", "scalar", referenceTime, repeats * n / referenceTime / 1e6);
+		printf("%10s %10.3f %12.1f\n", "batched", kernelTime, repeats * n / kernelTime / 1e6);
+		// keeps the compiler from dropping the timed loops
+		printf("checksum: %.3f\n", out[n/3] + ref[n/3]);
+
+		return ok;
+	}
+
+	// non-dominated sorting + crowding against one generation of evaluation
+	static bool nds(const Net &mother, const Drone &drone, const World &world) {
+		bool ok = true;
+
+		printf("Non-dominated sorting benchmark\n");
+		printf("%7s %3s %8s %8s %12s %12s %8s\n", "N", "M", "kind", "fronts", "ENS-BS [ms]", "naive [ms]", "check");
+
+		for (const size_t N : {1000, 10000}) {
+			for (const size_t M : {2, 3}) {
+				for (const bool discrete : {false, true}) {
+					// uniform points, or drone-like ones (few goal levels, lots of ties)
+					std::uniform_real_distribution<float> distr(0.0f, 1.0f);
+					std::uniform_int_distribution<int> goals(0, 6);
+					std::vector<float> obj(N * M);
+					for (size_t i = 0; i < N; ++i) {
+						obj[i*M] = discrete ? -goals(gen) : distr(gen);
+						for (size_t k = 1; k < M; ++k) {
+							obj[i*M + k] = discrete ? std::round(distr(gen) * 100) : distr(gen);
+						}
+					}
+
+					std::vector<uint32_t> front, reference;
+					std::vector<float> distance;
+
+					auto start = Clock::now();
+					const size_t fronts = ParetoSort::rank(obj.data(), N, M, front);
+					ParetoSort::crowding(obj.data(), N, M, front, fronts, distance);
+					const double fastTime = seconds(start);
+
+					start = Clock::now();
+					ParetoSort::rankNaive(obj.data(), N, M, reference);
+					const double naiveTime = seconds(start);
+
+					const bool same = front == reference;
+					ok = ok && same;
+
+					printf("%7zu %3zu %8s %8zu %12.2f %12.2f %8s\n", N, M, discrete ? "drone" : "uniform", fronts,
+						   1000 * fastTime, 1000 * naiveTime, same ? "OK" : "FAILED");
+				}
+			}
+		}
+
+		// the sort has to stay small next to what a generation of that size costs to simulate
+		EasyEA ea(10000, mother, drone);
+		ea.verbose = false;
+		ea.enableMultiObjective(MultiObjectiveConfig{});
+
+		auto start = Clock::now();
+		while (!ea.update(dt, world, false)) {}
+		const double evalTime = seconds(start);
+
+		start = Clock::now();
+		ea.process();
+		const double processTime = seconds(start);
+
+		printf("EasyEA(10000) generation: evaluation %.2f ms, process (incl. NSGA-II ranking) %.2f ms\n",
+			   1000 * evalTime, 1000 * processTime);
+
+		return ok;
+	}
+
+	// save/load time and size of binary checkpoints vs. the JSON saves
+	static bool checkpoint(const Net &mother, const Drone &drone) {
+		assert(std::filesystem::exists("saves") && "'saves' directory in build is missing!");
+		bool ok = true;
+
+		printf("Checkpoint benchmark - EasyEA, %zu weights per genome\n", mother.getWeights().size());
+		printf("%8s %6s %10s %10s %10s %8s\n", "popSize", "format", "save [ms]", "load [ms]", "size [MB]", "check");
+
+		for (const size_t popSize : {1000, 10000, 100000}) {
+			EasyEA ea(popSize, mother, drone);
+			const EASnapshot snap = ea.snapshot();
+
+			auto report = [&](const char *format, const std::string &path, double saveTime) {
+				auto start = Clock::now();
+				std::unique_ptr<AbstractEA> loaded = Loader::loadEA(path, drone);
+				const double loadTime = seconds(start);
+
+				// bit exact round trip
+				const EASnapshot back = loaded->snapshot();
+				const bool same = back.weights == snap.weights;
+				ok = ok && same;
+
+				printf("%8zu %6s %10.1f %10.1f %10.2f %8s\n", popSize, format, 1000 * saveTime, 1000 * loadTime,
+					   std::filesystem::file_size(path) / 1e6, same ? "OK" : "FAILED");
+				std::filesystem::remove(path);
+			};
+
+			const std::string ckptPath = "saves/bench_checkpoint.ckpt";
+			auto start = Clock::now();
+			Checkpoint::write(ckptPath, ea.snapshot());
+			report("binary", ckptPath, seconds(start));
+
+			// the JSON saves get too slow for the largest population
+			if (popSize > 10000) continue;
+
+			const std::string jsonPath = "saves/bench_checkpoint.json";
+			start = Clock::now();
+			ea.saveProcedure(jsonPath);
+			report("json", jsonPath, seconds(start));
+		}
+
+		return ok;
+	}
+
+	// time the evolution thread loses per save - synchronous write+fsync vs. the background writer
+	static void asyncSave(const Net &mother, const Drone &drone) {
+		assert(std::filesystem::exists("saves") && "'saves' directory in build is missing!");
+
+		const int saves = 6;
+		printf("Async checkpoint benchmark - %d saves back to back per setting\n", saves);
+		// "fastest" is a save that did not hit back-pressure - the usual case with saves far apart
+		printf("%8s %8s %16s %14s %10s %8s\n", "popSize", "mode", "per save [ms]", "fastest [ms]", "total [ms]", "stalls");
+
+		for (const size_t popSize : {10000, 100000}) {
+			EasyEA ea(popSize, mother, drone);
+			auto name = [](int s) { return "bench_async_" + std::to_string(s); };
+			auto path = [&](int s) { return "saves/" + name(s) + ".ckpt"; };
+
+			double fastest = std::numeric_limits<double>::max();
+			auto start = Clock::now();
+			for (int s = 0; s < saves; ++s) {
+				auto saveStart = Clock::now();
+				Checkpoint::write(path(s), ea.snapshot(), true);
+				fastest = std::min(fastest, seconds(saveStart));
+			}
+			const double syncTime = seconds(start);
+			printf("%8zu %8s %16.1f %14.1f %10.1f %8s\n", popSize, "sync", 1000 * syncTime / saves, 1000 * fastest, 1000 * syncTime, "-");
+
+			CheckpointWriter writer(2);
+			double submitTime = 0;
+			fastest = std::numeric_limits<double>::max();
+			start = Clock::now();
+			for (int s = 0; s < saves; ++s) {
+				auto submitStart = Clock::now();
+				ea.saveEA(name(s), writer);
+				submitTime += seconds(submitStart);
+				fastest = std::min(fastest, seconds(submitStart));
+			}
+			writer.flush();
+			const double asyncTime = seconds(start);
+			printf("%8zu %8s %16.1f %14.1f %10.1f %8lu\n", popSize, "async", 1000 * submitTime / saves, 1000 * fastest, 1000 * asyncTime, writer.backPressureStalls());
+
+			for (int s = 0; s < saves; ++s) {
+				std::filesystem::remove(path(s));
+			}
+		}
+	}
+
+	// checkpoint history of consecutive generations vs. full checkpoints of each - size, append cost,
+	// random access, and a bit exact check of every stored generation
+	static bool history(const Net &mother, const Drone &drone, const World &world, const int generations) {
+		assert(std::filesystem::exists("saves") && "'saves' directory in build is missing!");
+		bool ok = true;
+
+		printf("Checkpoint history benchmark - %d consecutive generations, keyframe every 16\n", generations);
+		printf("%8s %8s %12s %12s %8s %12s %14s %8s\n", "EA", "popSize", "full [MB]", "history [MB]", "ratio", "append [ms]", "random [ms]", "check");
+
+		auto run = [&](AbstractEA &ea) {
+			const std::string path = "saves/bench_history_" + ea.typeName();
+			std::filesystem::remove(History::historyPath(path));
+			std::filesystem::remove(History::indexPath(path));
+
+			std::vector<EASnapshot> stored;
+			double appendTime = 0;
+			{
+				CheckpointHistory history(path);
+				for (int g = 1; g <= generations; ++g) {
+					evolve(ea, world, g);
+					stored.push_back(ea.snapshot());
+
+					auto start = Clock::now();
+					history.append(stored.back(), false);
+					appendTime += seconds(start);
+				}
+			}
+
+			CheckpointHistoryView view(path);
+			const double full = stored.size() * stored[0].popSize * stored[0].genomeSize * sizeof(float);
+			const double kept = std::filesystem::file_size(History::historyPath(path)) + std::filesystem::file_size(History::indexPath(path));
+
+			// newest first - the worst case decodes a keyframe + 15 deltas
+			bool same = view.entries().size() == stored.size();
+			double accessTime = 0;
+			for (size_t s = stored.size(); s-- > 0 && same;) {
+				auto start = Clock::now();
+				const EASnapshot back = view.snapshot(stored[s].generation);
+				accessTime = std::max(accessTime, seconds(start));
+
+				same = back.weights == stored[s].weights;
+			}
+			ok = ok && same;
+
+			printf("%8s %8zu %12.2f %12.2f %8.1f %12.2f %14.2f %8s\n", ea.typeName().c_str(), ea.populationSize(), full / 1e6, kept / 1e6,
+				   full / kept, 1000 * appendTime / generations, 1000 * accessTime, same ? "OK" : "FAILED");
+
+			std::filesystem::remove(History::historyPath(path));
+			std::filesystem::remove(History::indexPath(path));
+		};
+
+		EasyEA easy(128, mother, drone);
+		run(easy);
+
+		CoSyNE cosyne(256, mother, drone);
+		run(cosyne);
+
+		return ok;
+	}
+
+	// cost of the trajectory recorder - same seeded run without and with recording
+	static bool trajectory(const Net &mother, const Drone &drone, const World &world, const int generations) {
+		const std::string path = "saves/bench_trajectory.traj";
+		const int runs = 3;
+		bool ok = true;
+
+		printf("Trajectory recorder benchmark - EasyEA(128), %d generations, best 4 recorded, %d runs\n", generations, runs);
+		printf("%10s %12s %10s %12s %10s %10s %8s\n", "recording", "gen [ms]", "overhead", "log [MB]", "episodes", "dropped", "check");
+
+		double baseTime = 0;
+		float baseBest = 0;
+		for (const bool recording : {false, true}) {
+			double time = 0;
+			float best = 0;
+			TrajectoryStats stats;
+
+			for (int run = 0; run < runs; ++run) {
+				std::filesystem::remove(path);
+				gen.seed(2000 + run);
+				EasyEA ea(128, mother, drone);
+				if (recording) ea.enableTrajectories(path, TrajectoryConfig{.bestCount = 4});
+
+				auto start = Clock::now();
+				best += evolve(ea, world, generations);
+				time += seconds(start);
+
+				if (recording) {
+					ea.trajectories->flush();
+					stats = ea.trajectories->statistics();
+					ok = ok && std::filesystem::file_size(path) == stats.bytes;
+				}
+			}
+
+			if (!recording) {
+				baseTime = time;
+				baseBest = best;
+			}
+
+			// recording must not change the run
+			const bool same = best == baseBest;
+			ok = ok && same;
+
+			printf("%10s %12.2f %9.1f%% %12.2f %10lu %10lu %8s\n", recording ? "on" : "off", 1000 * time / (runs * generations),
+				   100 * (time / baseTime - 1), stats.bytes / 1e6, (unsigned long)stats.episodes, (unsigned long)stats.dropped, same ? "OK" : "FAILED");
+		}
+
+		std::filesystem::remove(path);
+		return ok;
+	}
+
+	// EAWindowRunner's evolution worker with a reader taking snapshots at 60 Hz (the window thread)
+	// against the same seeded evolution without one - the visual session should cost nothing
+	static bool windowed(const Net &mother, const Drone &drone, const World &world, const int generations) {
+		printf("Windowed evolution benchmark - EasyEA(128), %d generations, snapshot reader at 60 Hz\n", generations);
+		printf("%10s %10s %10s %16s %8s\n", "loop", "time [s]", "gen/s", "snapshots read", "check");
+
+		gen.seed(3000);
+		EasyEA plain(128, mother, drone);
+		auto start = Clock::now();
+		const float plainBest = evolve(plain, world, generations);
+		const double plainTime = seconds(start);
+		printf("%10s %10.2f %10.2f %16s %8s\n", "console", plainTime, generations / plainTime, "-", "-");
+
+		gen.seed(3000);
+		EasyEA ea(128, mother, drone);
+		ea.verbose = false;
+
+		EAWindowRunner runner;
+		runner.verbose = false;
+		runner.worldLevels = {world};
+
+		std::atomic<bool> done{false};
+		uint64_t reads = 0;
+		uint64_t lastGeneration = 0;
+		bool ordered = true;
+		std::thread reader([&]{
+			while (!done) {
+				if (runner.snapshots.update()) {
+					reads += 1;
+					// the reader only ever moves forward
+					ordered = ordered && runner.snapshots.front().generation >= lastGeneration;
+					lastGeneration = runner.snapshots.front().generation;
+				}
+				std::this_thread::sleep_for(std::chrono::microseconds(16667));
+			}
+		});
+
+		start = Clock::now();
+		runner.evolve(ea, generations, "bench");
+		const double time = seconds(start);
+		done = true;
+		reader.join();
+
+		// the worker runs the same evolution
+		const bool same = ea.lastFitnessStats.max == plainBest && ordered;
+		printf("%10s %10.2f %10.2f %16lu %8s\n", "window", time, generations / time, (unsigned long)reads, same ? "OK" : "FAILED");
+
+		return same;
+	}
+
+	// frame time of whole populations - Renderer::draw_body per drone against the batched
+	// PopulationRenderer, drawn into an offscreen texture (needs an OpenGL context)
+	static bool population(const size_t maxDrones) {
+		sf::RenderTexture texture;
+		if (!texture.create(winWidth, winHeight)) {
+			printf("Population render benchmark needs an OpenGL context (xvfb-run on machines without a display)\n");
+			return false;
+		}
+
+		const int frames = 20;
+		Renderer renderer;
+		PopulationRenderer batched;
+
+		printf("Population render benchmark - %dx%d offscreen, %d frames per setting\n", winWidth, winHeight, frames);
+		printf("%8s %12s %14s %16s %16s %8s\n", "drones", "vertices", "build [ms]", "batched [ms]", "per drone [ms]", "speedup");
+
+		// waits for the GPU - display() only queues the work
+		auto frameTime = [&](auto &&drawFrame) {
+			auto start = Clock::now();
+			for (int f = 0; f < frames; ++f) {
+				texture.clear();
+				drawFrame();
+				texture.display();
+			}
+			texture.getTexture().copyToImage();
+			return 1000 * seconds(start) / frames;
+		};
+
+		std::uniform_real_distribution<float> posDistr(50, winWidth - 50);
+		std::uniform_real_distribution<float> angleDistr(-1, 1);
+
+		for (size_t n : {1000, 2000, 5000, 10000}) {
+			if (n > maxDrones) break;
+
+			std::vector<std::unique_ptr<Drone>> drones;
+			for (size_t i = 0; i < n; ++i) {
+				drones.push_back(std::make_unique<Drone>(sf::Vector2f{posDistr(gen), posDistr(gen)}));
+				drones[i]->angle = angleDistr(gen);
+				drones[i]->control(angleDistr(gen), angleDistr(gen), angleDistr(gen), angleDistr(gen));
+				drones[i]->thrusterLeft.update(dt);
+				drones[i]->thrusterRight.update(dt);
+			}
+
+			auto start = Clock::now();
+			for (int f = 0; f < frames; ++f) {
+				batched.begin();
+				for (auto && d : drones) batched.add(*d);
+			}
+			const double build = 1000 * seconds(start) / frames;
+
+			const double batchedTime = frameTime([&]{
+				batched.begin();
+				for (auto && d : drones) batched.add(*d);
+				batched.draw(&texture);
+			});
+
+			const double perDrone = frameTime([&]{
+				for (auto && d : drones) renderer.draw_body(d.get(), &texture);
+			});
+
+			printf("%8zu %12zu %14.2f %16.2f %16.2f %8.1f\n", n, batched.vertexCount(), build, batchedTime, perDrone, perDrone / batchedTime);
+		}
+
+		return true;
+	}
+
+	// JSON save loading - streamed (SAX) vs. the whole DOM
+	// peak memory is what the load adds on top of the process, the loaded EA itself included
+	static bool jsonLoad(const Net &mother, const Drone &drone, const size_t popSize) {
+		assert(std::filesystem::exists("saves") && "'saves' directory in build is missing!");
+
+		const std::string path = "saves/bench_load.json";
+		EASnapshot original;
+		{
+			EasyEA ea(popSize, mother, drone);
+			ea.saveProcedure(path);
+			original = ea.snapshot();
+		}
+
+		printf("JSON load benchmark - EasyEA pop %zu, %zu weights per genome, save %.1f MB\n", popSize, original.genomeSize,
+			   std::filesystem::file_size(path) / 1e6);
+		printf("%8s %10s %16s %8s\n", "loader", "load [ms]", "peak [MB]", "check");
+
+		bool ok = true;
+		auto measure = [&](const char *name, auto &&load) {
+			// memory freed by the previous load has to go back to the system first
+			malloc_trim(0);
+			std::ofstream("/proc/self/clear_refs") << "5"; // resets the peak (VmHWM)
+			const double before = memoryMB("VmRSS:");
+
+			auto start = Clock::now();
+			std::unique_ptr<AbstractEA> ea = load();
+			const double loadTime = seconds(start);
+			const double peak = memoryMB("VmHWM:");
+
+			const bool same = ea->snapshot().weights == original.weights;
+			ok = ok && same;
+
+			printf("%8s %10.1f %16.1f %8s\n", name, 1000 * loadTime, peak - before, same ? "OK" : "FAILED");
+		};
+
+		measure("sax", [&]{ return Loader::loadJson(path, drone); });
+		measure("dom", [&]{ return Loader::loadJsonDom(path, drone); });
+
+		std::filesystem::remove(path);
+		return ok;
+	}
+
+	// field of /proc/self/status in MB (0 when there is none)
+	static double memoryMB(const std::string &field) {
+		std::ifstream status("/proc/self/status");
+		std::string line;
+		while (std::getline(status, line)) {
+			if (line.rfind(field, 0) == 0) return std::stod(line.substr(field.size())) / 1024.0;
+		}
+		return 0;
+	}
+};
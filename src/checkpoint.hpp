@@ -0,0 +1,340 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "net.hpp"
+
+// large float arrays of the run state - stored raw next to the weights, not in the JSON state
+enum class SnapshotBlock : size_t {
+	NoveltyArchive,   // behaviours of the novelty archive
+	SurrogateGenomes, // surrogate history, transposed (historySize floats per weight)
+	SurrogateFitness, // fitness of the surrogate history
+	Count
+};
+
+// Everything a checkpoint stores about an EA - a copy, so it can be written
+// while the EA keeps running. The weights are already laid out like the
+// checkpoint's weight block, writing them is a single call.
+struct EASnapshot {
+	static constexpr size_t blockFloats = 16; // genomes are padded to 64 bytes
+
+	std::string type;
+	size_t popSize = 0;
+	uint64_t generation = 0;
+	json motherDescription;
+	json state; // everything else a resumed run needs (EA counters, RNG, runner level, ...)
+	std::array<std::vector<float>, (size_t)SnapshotBlock::Count> blocks; // empty = not stored
+
+	std::vector<float>& block(const SnapshotBlock b) {
+		return blocks[(size_t)b];
+	}
+
+	size_t genomeSize = 0;
+	size_t genomeStride = 0;
+	std::vector<float> weights; // popSize * genomeStride, zero padded
+
+	// keeps the allocation when the layout did not change (reused snapshots)
+	void setLayout(const size_t popSize, const size_t genomeSize) {
+		const size_t stride = (genomeSize + blockFloats - 1) / blockFloats * blockFloats;
+		if (this->popSize != popSize || this->genomeSize != genomeSize || weights.size() != popSize * stride) {
+			weights.assign(popSize * stride, 0.0f);
+		}
+
+		this->popSize = popSize;
+		this->genomeSize = genomeSize;
+		this->genomeStride = stride;
+	}
+
+	float* genome(const size_t i) {
+		return weights.data() + i * genomeStride;
+	}
+
+	const float* genome(const size_t i) const {
+		return weights.data() + i * genomeStride;
+	}
+};
+
+// Binary checkpoint layout (version 3, host byte order):
+//
+//   [CheckpointHeader]           fixed 256 bytes
+//   [mother net description]     JSON text, motherSize bytes at motherOffset
+//   [run state]                  JSON text, stateSize bytes at stateOffset (version 2+)
+//   [float blocks]               novelty archive, surrogate history (version 3+), each at
+//                                blockOffset[b] (64-byte aligned), blockSize[b] floats
+//   [population weights]         at weightsOffset (64-byte aligned), popSize genomes,
+//                                each genomeStride floats (zero padded to 64 bytes)
+//
+// The weights and blocks are used straight from the mapped file, nothing gets parsed
+// except the small net description and run state.
+// Older versions had zeros where the newer fields are now, they read as "no state" / "no blocks".
+// Version 2 kept the blocks' content in the JSON state, it still loads from there.
+struct CheckpointHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;     // byteOrderMark as written - a different value means a foreign machine
+	char type[32];          // EA type, same names as the JSON saves
+	uint64_t popSize;
+	uint64_t genomeSize;    // floats per genome
+	uint64_t genomeStride;  // floats between two genomes
+	uint64_t generation;
+	uint64_t motherOffset;
+	uint64_t motherSize;
+	uint64_t weightsOffset;
+	uint64_t fileSize;
+	uint64_t stateOffset;
+	uint64_t stateSize;
+	uint64_t blockOffset[4]; // indexed by SnapshotBlock
+	uint64_t blockSize[4];   // in floats, 0 = not stored
+	uint8_t reserved[64];
+};
+static_assert((size_t)SnapshotBlock::Count <= 4, "Checkpoint header has room for 4 float blocks");
+static_assert(sizeof(CheckpointHeader) == 256, "Checkpoint header has to stay 256 bytes");
+
+struct Checkpoint {
+	static constexpr char magic[8] = {'G', 'B', 'D', 'C', 'K', 'P', 'T', '\0'};
+	static constexpr uint32_t version = 3;
+	static constexpr uint32_t oldestVersion = 1;
+	static constexpr uint32_t byteOrderMark = 0x01020304;
+	static constexpr uint64_t alignment = 64;
+	static_assert(EASnapshot::blockFloats * sizeof(float) == alignment, "Snapshot padding has to match the checkpoint alignment");
+
+	static uint64_t alignUp(const uint64_t value, const uint64_t to) {
+		return (value + to - 1) / to * to;
+	}
+
+	// cheap check of the first bytes (the loader uses it to tell checkpoints from JSON)
+	static bool isCheckpoint(const std::string &path) {
+		char head[sizeof(magic)] = {};
+		std::ifstream file(path, std::ios::binary);
+		file.read(head, sizeof(head));
+		return file.gcount() == sizeof(head) && std::memcmp(head, magic, sizeof(magic)) == 0;
+	}
+
+	// sync = fsync the file (and its directory) before returning
+	static void write(const std::string &path, const EASnapshot &snapshot, const bool sync = false) {
+		const std::string mother = snapshot.motherDescription.dump();
+		const std::string state = snapshot.state.is_null() ? std::string() : snapshot.state.dump();
+
+		CheckpointHeader header{};
+		std::memcpy(header.magic, magic, sizeof(magic));
+		header.version = version;
+		header.byteOrder = byteOrderMark;
+		assert(snapshot.type.size() < sizeof(header.type) && "EA type name too long for the checkpoint header");
+		std::memcpy(header.type, snapshot.type.data(), snapshot.type.size());
+		header.popSize = snapshot.popSize;
+		header.genomeSize = snapshot.genomeSize;
+		header.genomeStride = snapshot.genomeStride;
+		header.generation = snapshot.generation;
+		header.motherOffset = sizeof(CheckpointHeader);
+		header.motherSize = mother.size();
+		header.stateOffset = header.motherOffset + header.motherSize;
+		header.stateSize = state.size();
+
+		uint64_t offset = header.stateOffset + header.stateSize;
+		for (size_t b = 0; b < snapshot.blocks.size(); ++b) {
+			if (snapshot.blocks[b].empty()) continue;
+
+			header.blockOffset[b] = alignUp(offset, alignment);
+			header.blockSize[b] = snapshot.blocks[b].size();
+			offset = header.blockOffset[b] + header.blockSize[b] * sizeof(float);
+		}
+
+		header.weightsOffset = alignUp(offset, alignment);
+		header.fileSize = header.weightsOffset + header.popSize * header.genomeStride * sizeof(float);
+
+		// written to a temporary file first - a crash mid-write never leaves a broken checkpoint behind
+		const std::string tmpPath = path + ".tmp";
+		std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(mother.data(), mother.size());
+		file.write(state.data(), state.size());
+
+		const std::vector<char> zeros(alignment, 0);
+		uint64_t written = header.stateOffset + header.stateSize;
+		for (size_t b = 0; b < snapshot.blocks.size(); ++b) {
+			if (snapshot.blocks[b].empty()) continue;
+
+			file.write(zeros.data(), header.blockOffset[b] - written);
+			file.write(reinterpret_cast<const char*>(snapshot.blocks[b].data()), snapshot.blocks[b].size() * sizeof(float));
+			written = header.blockOffset[b] + header.blockSize[b] * sizeof(float);
+		}
+		file.write(zeros.data(), header.weightsOffset - written);
+
+		assert(snapshot.weights.size() == header.popSize * header.genomeStride && "Snapshot weights do not match its layout");
+		file.write(reinterpret_cast<const char*>(snapshot.weights.data()), snapshot.weights.size() * sizeof(float));
+
+		file.close();
+		if (!file) {
+			throw std::runtime_error("Writing checkpoint failed: " + tmpPath);
+		}
+
+		if (sync) fsyncPath(tmpPath, O_WRONLY);
+
+		std::filesystem::rename(tmpPath, path);
+
+		// the rename itself is only durable once the directory entry is
+		if (sync) fsyncPath(std::filesystem::absolute(path).parent_path().string(), O_RDONLY | O_DIRECTORY);
+	}
+
+	// small text file naming the newest checkpoint of a run - resuming reads just this
+	// and one header instead of scanning the saves
+	static void writeLatest(const std::string &pointerPath, const std::string &checkpointPath) {
+		const std::string tmpPath = pointerPath + ".tmp";
+		{
+			std::ofstream file(tmpPath, std::ios::trunc);
+			file << checkpointPath << std::endl;
+			if (!file) {
+				throw std::runtime_error("Writing checkpoint pointer failed: " + tmpPath);
+			}
+		}
+		fsyncPath(tmpPath, O_WRONLY);
+		std::filesystem::rename(tmpPath, pointerPath);
+	}
+
+	// path of the newest checkpoint, empty when there is none (or it is gone)
+	static std::string readLatest(const std::string &pointerPath) {
+		std::ifstream file(pointerPath);
+		std::string path;
+		if (!file || !std::getline(file, path) || !std::filesystem::exists(path)) return "";
+
+		return path;
+	}
+
+private:
+	static void fsyncPath(const std::string &path, const int flags) {
+		const int fd = ::open(path.c_str(), flags);
+		if (fd < 0 || ::fsync(fd) != 0) {
+			if (fd >= 0) ::close(fd);
+			throw std::runtime_error("fsync failed: " + path);
+		}
+		::close(fd);
+	}
+};
+
+// Read-only memory mapped checkpoint.
+struct CheckpointView {
+	CheckpointView(const std::string &path) {
+		fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("Cannot open checkpoint: " + path);
+		}
+
+		struct stat st;
+		if (::fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(CheckpointHeader)) {
+			::close(fd);
+			throw std::runtime_error("Checkpoint too small: " + path);
+		}
+		size = st.st_size;
+
+		data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			::close(fd);
+			throw std::runtime_error("Cannot map checkpoint: " + path);
+		}
+
+		const CheckpointHeader &h = header();
+		if (std::memcmp(h.magic, Checkpoint::magic, sizeof(Checkpoint::magic)) != 0 ||
+			h.byteOrder != Checkpoint::byteOrderMark ||
+			h.version < Checkpoint::oldestVersion || h.version > Checkpoint::version ||
+			h.fileSize != size ||
+			h.weightsOffset % Checkpoint::alignment != 0 ||
+			h.genomeStride < h.genomeSize ||
+			h.weightsOffset > h.fileSize ||
+			h.motherSize > h.weightsOffset || h.motherOffset > h.weightsOffset - h.motherSize ||
+			(h.stateSize > 0 && (h.stateSize > h.weightsOffset || h.stateOffset > h.weightsOffset - h.stateSize)) ||
+			// the sizes come from the file - compared by division, a product could overflow
+			(h.genomeStride > 0 && h.popSize > (h.fileSize - h.weightsOffset) / sizeof(float) / h.genomeStride) ||
+			h.weightsOffset + h.popSize * h.genomeStride * sizeof(float) != h.fileSize ||
+			!blocksValid()) {
+			release();
+			throw std::runtime_error("Invalid or unsupported checkpoint: " + path);
+		}
+	}
+
+	~CheckpointView() {
+		release();
+	}
+
+	CheckpointView(const CheckpointView&) = delete;
+	CheckpointView& operator=(const CheckpointView&) = delete;
+
+	const CheckpointHeader& header() const {
+		return *static_cast<const CheckpointHeader*>(data);
+	}
+
+	std::string type() const {
+		return std::string(header().type, strnlen(header().type, sizeof(header().type)));
+	}
+
+	json motherDescription() const {
+		const char *text = bytes() + header().motherOffset;
+		return json::parse(text, text + header().motherSize);
+	}
+
+	// empty (null) for checkpoints without a run state
+	json state() const {
+		if (header().stateSize == 0) return json();
+
+		const char *text = bytes() + header().stateOffset;
+		return json::parse(text, text + header().stateSize);
+	}
+
+	const float* genome(const size_t i) const {
+		return reinterpret_cast<const float*>(bytes() + header().weightsOffset) + i * header().genomeStride;
+	}
+
+	// empty for blocks the checkpoint does not store (and versions before 3)
+	std::span<const float> block(const SnapshotBlock b) const {
+		const CheckpointHeader &h = header();
+		if (h.version < 3 || h.blockSize[(size_t)b] == 0) return {};
+
+		return {reinterpret_cast<const float*>(bytes() + h.blockOffset[(size_t)b]), h.blockSize[(size_t)b]};
+	}
+
+private:
+	int fd = -1;
+	void *data = nullptr;
+	size_t size = 0;
+
+	const char* bytes() const {
+		return static_cast<const char*>(data);
+	}
+
+	// every stored block lies (aligned) in front of the weights
+	bool blocksValid() const {
+		const CheckpointHeader &h = header();
+		if (h.version < 3) return true;
+
+		for (size_t b = 0; b < (size_t)SnapshotBlock::Count; ++b) {
+			if (h.blockSize[b] == 0) continue;
+			if (h.blockOffset[b] % Checkpoint::alignment != 0 ||
+				h.blockSize[b] > h.weightsOffset / sizeof(float) ||
+				h.blockOffset[b] > h.weightsOffset - h.blockSize[b] * sizeof(float)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void release() {
+		if (data && data != MAP_FAILED) ::munmap(data, size);
+		if (fd >= 0) ::close(fd);
+		data = nullptr;
+		fd = -1;
+	}
+};
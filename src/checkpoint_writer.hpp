@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "history.hpp"
+
+// Writes checkpoints (and checkpoint history records) on a background thread. The caller
+// only pays for the population snapshot (a copy), serialization and fsync happen off its path.
+// The queue is bounded - once `capacity` saves are waiting, submit() blocks
+// until the writer catches up, so a slow disk can't pile up snapshots in memory.
+// The thread only starts with the first submit - most runners never save.
+struct CheckpointWriter {
+	CheckpointWriter(size_t capacity = 2) : capacity(std::max<size_t>(1, capacity)) {}
+
+	~CheckpointWriter() {
+		{
+			std::lock_guard<std::mutex> lock(queueLock);
+			stopFlag = true;
+		}
+		queueSignal.notify_all();
+		if (worker.joinable()) worker.join();
+	}
+
+	CheckpointWriter(const CheckpointWriter&) = delete;
+	CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+	// safe to call from several threads (the islands)
+	// latest - optional pointer file that gets updated to this checkpoint once it is on disk
+	void submit(const std::string &path, EASnapshot &&snapshot, const std::string &latest = "") {
+		std::unique_lock<std::mutex> lock(queueLock);
+
+		if (queue.size() >= capacity) {
+			stalls += 1;
+			spaceSignal.wait(lock, [&]{ return queue.size() < capacity; });
+		}
+
+		queue.push_back(Job{path, latest, std::move(snapshot)});
+		startWorker();
+		queueSignal.notify_one();
+	}
+
+	// appends the snapshot to a checkpoint history instead (delta encoding happens on the writer thread too),
+	// the history has to outlive the pending jobs
+	void submit(CheckpointHistory &history, EASnapshot &&snapshot) {
+		std::unique_lock<std::mutex> lock(queueLock);
+
+		if (queue.size() >= capacity) {
+			stalls += 1;
+			spaceSignal.wait(lock, [&]{ return queue.size() < capacity; });
+		}
+
+		queue.push_back(Job{"", "", std::move(snapshot), &history});
+		startWorker();
+		queueSignal.notify_one();
+	}
+
+	// an empty snapshot, or one whose write finished (its buffers get reused)
+	EASnapshot acquire() {
+		std::lock_guard<std::mutex> lock(queueLock);
+		if (spare.empty()) return EASnapshot();
+
+		EASnapshot snap = std::move(spare.back());
+		spare.pop_back();
+		return snap;
+	}
+
+	// blocks until everything submitted so far is on disk
+	void flush() {
+		std::unique_lock<std::mutex> lock(queueLock);
+		spaceSignal.wait(lock, [&]{ return queue.empty() && !writing; });
+	}
+
+	// how many times a submit had to wait for a free slot
+	uint64_t backPressureStalls() {
+		std::lock_guard<std::mutex> lock(queueLock);
+		return stalls;
+	}
+
+private:
+	const size_t capacity;
+
+	std::mutex queueLock;
+	std::condition_variable queueSignal; // new work or stop
+	std::condition_variable spaceSignal; // a slot got free / a write finished
+	struct Job {
+		std::string path;
+		std::string latest;
+		EASnapshot snapshot;
+		CheckpointHistory *history = nullptr;
+	};
+
+	std::deque<Job> queue;
+	std::vector<EASnapshot> spare; // written snapshots kept for reuse
+	bool writing = false;
+	bool stopFlag = false;
+	uint64_t stalls = 0;
+
+	std::thread worker;
+
+	// called with queueLock held
+	void startWorker() {
+		if (!worker.joinable()) worker = std::thread(&CheckpointWriter::writerLoop, this);
+	}
+
+	void writerLoop() {
+		while (true) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(queueLock);
+				queueSignal.wait(lock, [&]{ return stopFlag || !queue.empty(); });
+
+				// pending saves still get written on shutdown
+				if (queue.empty()) return;
+
+				job = std::move(queue.front());
+				queue.pop_front();
+				writing = true;
+			}
+			spaceSignal.notify_all();
+
+			try {
+				if (job.history) {
+					job.history->append(job.snapshot, true);
+				}
+				else {
+					Checkpoint::write(job.path, job.snapshot, true);
+					if (!job.latest.empty()) {
+						Checkpoint::writeLatest(job.latest, job.path);
+					}
+					std::cout << job.snapshot.type << " saved to a checkpoint: " << job.path << std::endl;
+				}
+			}
+			catch (const std::exception &e) {
+				std::cout << "Checkpoint save failed: " << e.what() << std::endl;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(queueLock);
+				writing = false;
+				if (spare.size() < capacity) spare.push_back(std::move(job.snapshot));
+			}
+			spaceSignal.notify_all();
+		}
+	}
+};
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <cassert>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "drone.hpp"
+#include "ea.hpp"
+#include "loader.hpp"
+#include "net.hpp"
+
+// Exports an evolved controller as a dependency-free C++ header - the weights as constexpr
+// arrays and a fully unrolled forward pass for its topology - plus a small check program
+// that compares the kernel with Net::predict outputs recorded at export time and measures its latency.
+//
+// The unrolled sums keep Net's order of operations (0 + x0*w0 + x1*w1 + ... + bias), so the kernel
+// is bit exact as long as neither side contracts to FMA or uses -ffast-math (the project builds for
+// the plain x86-64 target, which has no FMA to contract to).
+struct Codegen {
+	static std::string header(const Net &net, const std::string &name, const std::string &origin) {
+		std::string out;
+		out += "// Generated by GoodBoyDrone (./Drone export) - do not edit.\n";
+		out += "// Controller: " + origin + "\n";
+		out += "// Topology: " + topology(net) + "\n";
+		out += "//\n";
+		out += "// Bit exact with Net::predict when built without FMA contraction and -ffast-math\n";
+		out += "// (plain x86-64 target, or -ffp-contract=off with -march flags that enable FMA).\n";
+		out += "#pragma once\n\n";
+		out += "#include <cmath>\n\n";
+		out += "namespace " + name + " {\n\n";
+		out += "constexpr int inputSize = " + std::to_string(net.modules.front()->in) + ";\n";
+		out += "constexpr int outputSize = " + std::to_string(net.modules.back()->out) + ";\n\n";
+
+		for (size_t m = 0; m < net.modules.size(); ++m) {
+			const Module &mod = *net.modules[m];
+			if (mod.weights.empty()) continue;
+
+			out += "// module " + std::to_string(m) + " - " + moduleName(mod) + ": weights [out][in] row-major, then the biases\n";
+			out += "constexpr float m" + std::to_string(m) + "[" + std::to_string(mod.weights.size()) + "] = {\n";
+			for (size_t w = 0; w < mod.weights.size(); w += 6) {
+				out += "\t";
+				for (size_t c = w; c < std::min(w + 6, mod.weights.size()); ++c) {
+					out += literal(mod.weights[c]) + ",";
+					if (c + 1 < std::min(w + 6, mod.weights.size())) out += " ";
+				}
+				out += "\n";
+			}
+			out += "};\n\n";
+		}
+
+		out += "inline void forward(const float *in, float *out) {\n";
+
+		// previous values by name - the input array first, then the locals of every module
+		std::vector<std::string> prev;
+		for (size_t j = 0; j < net.modules.front()->in; ++j) {
+			prev.push_back("in[" + std::to_string(j) + "]");
+		}
+
+		for (size_t m = 0; m < net.modules.size(); ++m) {
+			const Module &mod = *net.modules[m];
+			const std::string arr = "m" + std::to_string(m);
+			out += "\t// module " + std::to_string(m) + " - " + moduleName(mod) + "\n";
+
+			std::vector<std::string> cur;
+			for (size_t i = 0; i < mod.out; ++i) {
+				const std::string var = "v" + std::to_string(m) + "_" + std::to_string(i);
+				cur.push_back(var);
+
+				std::string expr;
+				if (dynamic_cast<const Linear*>(&mod)) {
+					expr = "0.0f";
+					for (size_t j = 0; j < mod.in; ++j) {
+						expr += " + " + prev[j] + "*" + arr + "[" + std::to_string(i*mod.in + j) + "]";
+					}
+					expr += " + " + arr + "[" + std::to_string(mod.in*mod.out + i) + "]";
+				}
+				else if (dynamic_cast<const Tanh*>(&mod)) {
+					expr = "std::tanh(" + prev[i] + ")";
+				}
+				else if (dynamic_cast<const ReLU*>(&mod)) {
+					// std::max(0.0f, x)
+					expr = "(0.0f < " + prev[i] + ") ? " + prev[i] + " : 0.0f";
+				}
+				else {
+					assert(false && "Codegen does not know this module");
+				}
+
+				out += "\tconst float " + var + " = " + expr + ";\n";
+			}
+			out += "\n";
+			prev.swap(cur);
+		}
+
+		for (size_t k = 0; k < prev.size(); ++k) {
+			out += "\tout[" + std::to_string(k) + "] = " + prev[k] + ";\n";
+		}
+		out += "}\n\n";
+		out += "} // namespace " + name + "\n";
+
+		return out;
+	}
+
+	// standalone program - forward() against recorded Net::predict outputs + latency
+	static std::string checkProgram(const Net &net, const std::string &name, const std::string &headerFile, const size_t samples) {
+		const size_t I = net.modules.front()->in;
+		const size_t O = net.modules.back()->out;
+
+		std::string inputs, expected;
+
+		// observations are roughly in [-1, 1], a few exact values for the edge cases
+		std::uniform_real_distribution<float> distr(-1.5f, 1.5f);
+		for (size_t s = 0; s < samples; ++s) {
+			Input x(I);
+			for (size_t j = 0; j < I; ++j) {
+				x[j] = (s == 0) ? 0.0f : (s == 1) ? 1.0f : (s == 2) ? -1.0f : distr(gen);
+			}
+			const Output y = net.predict(x);
+
+			inputs += "\t{";
+			for (size_t j = 0; j < I; ++j) inputs += literal(x[j]) + ((j + 1 < I) ? ", " : "");
+			inputs += "},\n";
+
+			expected += "\t{";
+			for (size_t k = 0; k < O; ++k) expected += literal(y[k]) + ((k + 1 < O) ? ", " : "");
+			expected += "},\n";
+		}
+
+		std::string out;
+		out += "// Generated by GoodBoyDrone (./Drone export) - checks " + headerFile + " against Net::predict\n";
+		out += "// outputs recorded at export time and measures the latency of forward().\n";
+		out += "//   g++ -std=c++17 -O2 " + name + "_check.cpp -o " + name + "_check && ./" + name + "_check\n";
+		out += "#include \"" + headerFile + "\"\n\n";
+		out += "#include <chrono>\n#include <cmath>\n#include <cstdint>\n#include <cstdio>\n#include <cstring>\n\n";
+		out += "static constexpr int samples = " + std::to_string(samples) + ";\n\n";
+		out += "static const float inputs[samples][" + name + "::inputSize] = {\n" + inputs + "};\n\n";
+		out += "static const float expected[samples][" + name + "::outputSize] = {\n" + expected + "};\n\n";
+		out += R"(static int64_t ulps(const float a, const float b) {
+	int32_t ia, ib;
+	std::memcpy(&ia, &a, 4);
+	std::memcpy(&ib, &b, 4);
+	// same ordering for negative floats
+	if (ia < 0) ia = INT32_MIN - ia;
+	if (ib < 0) ib = INT32_MIN - ib;
+	return (ia > ib) ? (int64_t)ia - ib : (int64_t)ib - ia;
+}
+
+int main() {
+	int exact = 0;
+	int64_t maxUlps = 0;
+	float maxError = 0;
+
+	float out[NAME::outputSize];
+	for (int s = 0; s < samples; ++s) {
+		NAME::forward(inputs[s], out);
+		for (int k = 0; k < NAME::outputSize; ++k) {
+			exact += std::memcmp(&out[k], &expected[s][k], sizeof(float)) == 0;
+			maxUlps = (ulps(out[k], expected[s][k]) > maxUlps) ? ulps(out[k], expected[s][k]) : maxUlps;
+			maxError = (std::fabs(out[k] - expected[s][k]) > maxError) ? std::fabs(out[k] - expected[s][k]) : maxError;
+		}
+	}
+
+	const int total = samples * NAME::outputSize;
+	printf("%d/%d outputs bit exact, max %lld ulp, max abs error %g\n", exact, total, (long long)maxUlps, maxError);
+
+	// latency - the inputs rotate so nothing gets hoisted out of the loop
+	const int iterations = 1000000;
+	volatile float sink = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int it = 0; it < iterations; ++it) {
+		NAME::forward(inputs[it % samples], out);
+		for (int k = 0; k < NAME::outputSize; ++k) sink = sink + out[k];
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("forward: %.1f ns per call\n", 1e9 * seconds / iterations);
+
+	// contraction (FMA) is the only expected source of differences - it stays tiny
+	return (maxError <= 1e-5f) ? 0 : 1;
+}
+)";
+
+		// the raw string can't splice the namespace in
+		for (size_t at = out.find("NAME::"); at != std::string::npos; at = out.find("NAME::", at)) {
+			out.replace(at, 4, name);
+		}
+
+		return out;
+	}
+
+	// ./Drone export <save> [out header] [individual] - individual 0 is the best in both EAs' saves
+	static bool exportController(const std::string &savePath, const Drone &father, const std::string &headerPath, const size_t individual) {
+		std::unique_ptr<AbstractEA> ea = Loader::loadEA(savePath, father);
+		assert(individual < ea->populationSize() && "Exported individual is not in the population");
+
+		const Net &net = *(*ea)[individual].net;
+
+		const std::filesystem::path path(headerPath);
+		const std::string name = identifier(path.stem().string());
+		const std::string checkPath = (path.parent_path() / (name + "_check.cpp")).string();
+
+		const std::string origin = savePath + ", individual " + std::to_string(individual) + ", generation " + std::to_string(ea->generation);
+		std::ofstream(headerPath) << header(net, name, origin);
+		std::ofstream(checkPath) << checkProgram(net, name, path.filename().string(), 256);
+
+		// reference latency of the generic net
+		Input x(net.modules.front()->in, 0.5f);
+		const int iterations = 100000;
+		volatile float sink = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int it = 0; it < iterations; ++it) {
+			x[it % x.size()] = 0.001f * (it % 1000);
+			sink = sink + net.predict(x)[0];
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		printf("Exported %s (%s) to %s\n", origin.c_str(), topology(net).c_str(), headerPath.c_str());
+		printf("Check program: %s\n", checkPath.c_str());
+		printf("Net::predict: %.1f ns per call (compare with the check program)\n", 1e9 * seconds / iterations);
+		return true;
+	}
+
+private:
+	// exact float literal (hex float)
+	static std::string literal(const float value) {
+		if (value == 0.0f) return std::signbit(value) ? "-0.0f" : "0.0f";
+
+		char buffer[64];
+		std::snprintf(buffer, sizeof(buffer), "%af", value);
+		return buffer;
+	}
+
+	static std::string moduleName(const Module &mod) {
+		const json config = mod.saveConfig();
+		const std::string type = config.begin().key();
+
+		if (type == "Linear") return "Linear(" + std::to_string(mod.in) + ", " + std::to_string(mod.out) + ")";
+		return type + "(" + std::to_string(mod.out) + ")";
+	}
+
+	static std::string topology(const Net &net) {
+		std::string out;
+		for (auto && mod : net.modules) {
+			out += (out.empty() ? "" : " ") + moduleName(*mod);
+		}
+		return out;
+	}
+
+	// C++ identifier from a file name
+	static std::string identifier(std::string name) {
+		for (auto && c : name) {
+			if (!std::isalnum((unsigned char)c)) c = '_';
+		}
+		if (name.empty() || std::isdigit((unsigned char)name[0])) name = "c_" + name;
+		return name;
+	}
+};
@@ -10,17 +10,22 @@ using MetaPopulation = std::vector<SynapsePopulation>;
 
 // https://jmlr.csail.mit.edu/papers/volume9/gomez08a/gomez08a.pdf
 struct CoSyNE : public AbstractEA {
+	// breeding parameters (a sweep sets them right after construction)
+	float mutationProb = 0.05f;   // chance of a weight getting a Cauchy perturbation
+	float mutationScale = 0.3f;   // scale of the Cauchy perturbation
+	float parentFraction = 0.25f; // top part of the population carried over and bred from
+
 	CoSyNE(size_t popSize, const Net &mother, const Drone &father) : AbstractEA(popSize, mother, father), synapseCount(mother.getWeights().size()) { 
 		initPop(mother);
 		initAgents(father);
 	}
 
 	void process() override {
-		std::cout << "COSYNE Process" << std::endl;
+		if (verbose) std::cout << "COSYNE Process" << std::endl;
 
 		std::vector<size_t> fitnessOrder = fitnessAgents();
 
-		const size_t parentCount = popSize * 0.25;
+		const size_t parentCount = parents();
 
 		auto offspringPopW = crossover(fitnessOrder, parentCount);
 		mutation(offspringPopW);
@@ -37,6 +42,9 @@ struct CoSyNE : public AbstractEA {
 			newPopulationW[i] = offspringPopW[i-parentCount];
 		}
 
+		// permuteMeta reshuffles the genes of every slot but 0 - the evaluated parents are kept for emigrants()
+		topParents.assign(newPopulationW.begin(), newPopulationW.begin() + parentCount);
+
 		convert_WeightsToMeta(newPopulationW);
 
 		permuteMeta(fitnessOrder);
@@ -47,6 +55,29 @@ struct CoSyNE : public AbstractEA {
 		resetAgents();
 	}
 
+	std::vector<Weights> emigrants(size_t n) const override {
+		// the evaluated top parents in fitness order - before the first process() (or after a load) only slot 0
+		if (topParents.empty()) {
+			return std::vector<Weights>(populationW.begin(), populationW.begin() + std::min<size_t>(n, 1));
+		}
+
+		n = std::min(n, topParents.size());
+		return std::vector<Weights>(topParents.begin(), topParents.begin() + n);
+	}
+
+	size_t selectionSize() const override {
+		return parents();
+	}
+
+	// the mark probabilities of permuteMeta come from every rank's fitness and the worst one
+	bool selectionUsesAllRanks() const override {
+		return true;
+	}
+
+	std::string typeName() const override {
+		return "CoSyNE";
+	}
+
 	void saveProcedure(const std::string &path) const override {
 		json popW;
 
@@ -69,9 +100,24 @@ struct CoSyNE : public AbstractEA {
 		std::cout << "CoSyNE saved to a file: " << path << std::endl;
 	}
 
+protected:
+	// the meta population is built from populationW, a loaded one has to be split up again
+	void populationLoaded() override {
+		convert_WeightsToMeta(populationW);
+		topParents.clear();
+	}
+
 private:
 	MetaPopulation metaPopulation;
 	const size_t synapseCount;
+	std::vector<Weights> topParents; // parents of the last process(), as they were evaluated
+
+	// offspring come in pairs - the parent count is rounded up to leave an even rest
+	size_t parents() const {
+		size_t n = std::clamp<size_t>(popSize * parentFraction, 2, popSize);
+		if ((popSize - n) % 2) n += 1;
+		return std::min(n, popSize);
+	}
 
 	void initPop(const Net &mother) override {
 		AbstractEA::initPop(mother);
@@ -103,11 +149,7 @@ private:
 	// get indices corresponding to the sorted fitness values (without sorting them)
 	std::vector<size_t> fitnessAgents() override {
 		// produce the final fitness value for each agent
-		float fitnessSum = 0;
-		for (int i = 0; i < popSize; ++i) {
-			fitness[i] += 1000 * agents[i]->goalIndex;
-			fitnessSum += fitness[i];
-		}
+		finalizeFitness();
 
 		std::vector<size_t> idx(fitness.size());
 		std::iota(idx.begin(), idx.end(), 0);
@@ -115,11 +157,6 @@ private:
 
 		assert(fitness[idx[0]] >= fitness[idx[1]] && "Fitness sorting order incorrect");
 
-		lastFitnessStats.max = fitness[idx[0]];
-		lastFitnessStats.min = fitness[idx[popSize-1]];
-		lastFitnessStats.med = fitness[idx[popSize/2]];
-		lastFitnessStats.avg = fitnessSum / popSize;;
-
 		return idx;
 	}
 
@@ -159,10 +196,10 @@ private:
 	}
 
 	void mutation(std::vector<Weights> &offspringPopW) {
-		const float MUTPROB = 0.05f;
+		const float MUTPROB = mutationProb;
 
 		std::uniform_real_distribution<float> chanceDistr(0.0, 1.0);
-		std::cauchy_distribution<float> perturbedDistr(0, 0.3);
+		std::cauchy_distribution<float> perturbedDistr(0, mutationScale);
 
 		for (int i = 0; i < offspringPopW.size(); ++i) {
 			for (int k = 0; k < offspringPopW[i].size(); ++k) {
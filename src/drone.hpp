@@ -227,6 +227,13 @@ struct Drone {
     size_t goalIndex = 0;
     size_t goalTimer = 0;
 
+    // aliveTimer gets halved on goal collection, this one just counts the episode
+    uint64_t ticks = 0;
+    // tick of every goal collection (behaviour descriptor for novelty search)
+    std::vector<uint64_t> goalVisits;
+    // thrust spent over the episode (power integrated over time)
+    float energy = 0;
+
     std::vector<float> lastControls;
 
 	Drone(sf::Vector2f startPos) : startPos(startPos) { 
@@ -247,6 +254,10 @@ struct Drone {
         goalIndex = 0;
         goalTimer = 0;
 
+        ticks = 0;
+        goalVisits.clear();
+        energy = 0;
+
         thrusterLeft.reset();
         thrusterRight.reset();
 
@@ -289,9 +300,11 @@ struct Drone {
     void update(const float dt, const World &world) {
         if (!alive) return;
         aliveTimer += 1;
+        ticks += 1;
 
 		thrusterLeft.update(dt);
 		thrusterRight.update(dt);
+        energy += (thrusterLeft.power + thrusterRight.power) * dt;
 
 		const sf::Vector2f gravity{0, 10};
 		vel += gravity * dt;
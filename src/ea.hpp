@@ -1,14 +1,25 @@
 #pragma once
 
+#include "checkpoint.hpp"
+#include "checkpoint_writer.hpp"
 #include "drone.hpp"
+#include "fitness_cache.hpp"
 #include "net.hpp"
+#include "novelty.hpp"
+#include "nsga.hpp"
+#include "reward.hpp"
+#include "surrogate.hpp"
+#include "trajectory.hpp"
 #include "SFML/System/Vector2.hpp"
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <iostream>
 #include <memory>
+#include <numeric>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <filesystem>
@@ -28,12 +39,127 @@ struct FitnessStats {
 	float med = 0;
 };
 
+// Exact needs an EA whose breeding only looks at the top selectionSize() individuals - CoSyNE's
+// permutation probabilities depend on every rank and the worst fitness, so it refuses Exact.
+enum class RacingMode {
+	Off,
+	Exact,     // kill only drones that provably cannot make the selection cutoff
+	Threshold, // also kill drones that cannot beat last generation's cutoff
+};
+
+struct RacingStats {
+	uint64_t killed = 0;
+	uint64_t savedSteps = 0; // drone ticks the killed drones did not simulate before the generation ended
+	uint64_t steps = 0;      // drone ticks that were simulated
+};
+
+struct LiveStats {
+	uint64_t ticks = 0;          // length of the generation
+	uint64_t steps = 0;          // drone ticks that were simulated
+	float meanLiveFraction = 0;  // steps / (ticks * popSize)
+};
+
+// wall time (seconds) spent in the phases of one generation
+struct PhaseTimes {
+	using Clock = std::chrono::steady_clock;
+
+	double simulation = 0; // physics, goal collection and reward - the rest of the episode
+	double sensors = 0;    // observations (sensor ray casts)
+	double inference = 0;  // net forward passes
+	double selection = 0;  // process() - final fitness, selection and breeding
+	double io = 0;         // saves and telemetry
+
+	static double since(const Clock::time_point &start) {
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// what a now() + since() pair measures around nothing - taken off short timed sections,
+	// for which it is the same order as the section itself
+	static double clockCost() {
+		static const double cost = []{
+			constexpr int samples = 1000;
+			double total = 0;
+			for (int i = 0; i < samples; ++i) {
+				total += since(Clock::now());
+			}
+			return total / samples;
+		}();
+		return cost;
+	}
+};
+
 struct AbstractEA {
 	uint64_t generation = 0;
 	const size_t input_size;
 
 	FitnessStats lastFitnessStats;
 
+	// per-generation console chatter (islands/workers turn it off)
+	bool verbose = true;
+
+	// saves go to binary checkpoints, the (much larger and slower) JSON is an optional export
+	bool exportJson = false;
+
+	// optional novelty search - selection then works on the novelty/fitness blend
+	std::unique_ptr<NoveltySearch> novelty;
+
+	void enableNovelty(const NoveltyConfig &config) {
+		assert(!multiObjective && "Novelty search and multi-objective selection are exclusive");
+		novelty = std::make_unique<NoveltySearch>(config);
+	}
+
+	// optional multi-objective selection (goals, time to goal, energy) - NSGA-II ranks replace the fitness
+	std::unique_ptr<MultiObjective> multiObjective;
+
+	void enableMultiObjective(const MultiObjectiveConfig &config) {
+		assert(!novelty && "Novelty search and multi-objective selection are exclusive");
+		multiObjective = std::make_unique<MultiObjective>(config);
+	}
+
+	// the controller is queried every controlPeriod ticks, thrusters hold their command in between
+	uint64_t controlPeriod = 1;
+
+	// early termination of hopeless drones
+	RacingMode racing = RacingMode::Off;
+	uint64_t racingInterval = 10; // ticks between checks
+	RacingStats lastRacingStats;
+
+	// sensors and inference time of the running generation, measured by stepAgent when timePhases is on.
+	// Timing every drone tick costs more than the small net itself, so only every phaseSampling-th
+	// drone tick is timed and counts for the ones in between (prime - never in step with controlPeriod).
+	bool timePhases = false;
+	uint64_t phaseSampling = 17;
+	PhaseTimes phaseTimes;
+
+	// live drones per tick of the last generation
+	LiveStats lastLiveStats;
+	std::vector<uint32_t> lastLiveCurve;
+
+	// memoised outcomes of unchanged genomes (elites, carried-over parents) on static worlds
+	std::unique_ptr<FitnessCache> fitnessCache;
+	CacheStats lastCacheStats;
+
+	void enableFitnessCache() {
+		fitnessCache = std::make_unique<FitnessCache>();
+	}
+
+	// optional pre-screening - only the best predicted individuals get simulated,
+	// the rest gets a fitness imputed by the surrogate model
+	std::unique_ptr<Surrogate> surrogate;
+	SurrogateStats lastSurrogateStats;
+
+	void enableSurrogate(const SurrogateConfig &config) {
+		surrogate = std::make_unique<Surrogate>(config);
+	}
+
+	// optional binary log of the best episodes of every generation (see trajectory.hpp)
+	std::unique_ptr<TrajectoryRecorder> trajectories;
+
+	void enableTrajectories(const std::string &path, const TrajectoryConfig &config) {
+		assert(typeName() != "SteadyStateEA" && "SteadyStateEA evaluates on its workers, it has no generation episodes to record");
+		trajectories = std::make_unique<TrajectoryRecorder>(path, config, popSize);
+	}
+
 	AbstractEA(size_t popSize, const Net &mother, const Drone &father) : popSize(popSize), motherDescription(mother.describe()), input_size(mother.input_size)  {
 		assert(popSize % 2 == 0 && "PopSize should be divisible by 2! (Please)");
 
@@ -41,6 +167,7 @@ struct AbstractEA {
 		populationW.reserve(popSize);
 		agents.reserve(popSize);
 		fitness.resize(popSize);
+		killTick.resize(popSize);
 	}
 
 	virtual ~AbstractEA() {}
@@ -54,98 +181,670 @@ struct AbstractEA {
 		std::vector<float> observation;
 		observation.resize(input_size);
 
-		Output output;
-
-		bool someAlive = false;
-
-		Drone* drone;
-		Net* net;
-
-		for (int i = 0; i < popSize; ++i) {
-			drone = agents[i].get();
-			net = population[i].get();
-
-			drone->update(dt, world);
+		if (episodeTick == 0) {
+			beginEpisode(world);
+		}
 
-			if (!drone->alive) continue;
-			someAlive = true;
+		// the recorder check stays out of the per-drone loop
+		rewards.clear();
+		const size_t live = trajectories ? stepActive<true>(dt, world, observation, debug) : stepActive<false>(dt, world, observation, debug);
 
-			drone->genObservation_with_sensors(observation, world);
-			/* drone->genObservation_no_sensors(observation, world); */
+		if (timePhases) {
+			phaseTimes.sensors += phaseSampling * sampledTimes.sensors;
+			phaseTimes.inference += phaseSampling * sampledTimes.inference;
+			sampledTimes = PhaseTimes();
+		}
 
-			// hard-coded goal collection
-			sf::Vector2f goalDist = world.goals[drone->goalIndex % world.goals.size()] - drone->pos;
-			if (goalDist.x*goalDist.x + goalDist.y*goalDist.y < 100) {
-				drone->goalTimer += 1;
-				// half a second for 60 fps game physics - GOAL COLLECTED
-				if (drone->goalTimer > 30) {
-					drone->goalTimer = 0;
-					drone->goalIndex += 1;
-
-					// reward for quickly obtaining the goal
-					fitness[i] += (drone->goalIndex+1)*(600 - drone->aliveTimer);
-					drone->aliveTimer *= 0.5f;
-				}
-			}
-			else {
-				drone->goalTimer = 0;
-			}
+		// shaping reward of all live drones at once
+		rewards.apply(fitness);
 
-			// fitness calculation
-			float cosGx = cos((-goalDist.x/world.boundary.x) * M_PI/2.0f);
-			float cosGy = cos((-goalDist.y/world.boundary.y) * M_PI/2.0f);
-			cosGx = pow(cosGx, 4.0f);
-			cosGy = pow(cosGy, 4.0f);
-			// take the min because we want to penalize individuals going away
-			float cosG = std::min(cosGx, cosGy);
-
-			fitness[i] += (drone->goalIndex+1)*(cosG);
-
-			if (debug) {
-				if (i == 0) {
-					std::cout << "DEBUG:" << std::endl;
-					std::cout << "GD: " << goalDist.x/world.boundary.x << "," << goalDist.y/world.boundary.y << std::endl;
-					std::cout << "FGD: " << (drone->goalIndex+1)*(cosG) << std::endl;
-					std::cout << "Sensors: ["; 
-					for (int i = 0; i < 8; ++i) {
-						std::cout << observation[5+i] << ", ";
-					}
-					std::cout << "]" << std::endl;
-
-					std::cout << "velx: " << observation[0] << ", vely: " << observation[1] << std::endl;
-					std::cout << "cAngle: " << observation[2] << ", sAngle: " << observation[3] << std::endl;
-					std::cout << "avel: " << observation[4] << std::endl;
-				}
-			}
+		liveCurve.push_back(live);
+		racingStats.steps += live;
 
-			output = net->predict(observation);
-			assert(output.size() == 4 && "Drone expects 4 net outputs");
-			drone->control(output[0], output[1], output[2], output[3]);
+		episodeTick += 1;
+		if (racing != RacingMode::Off && live > 0 && episodeTick % racingInterval == 0) {
+			raceAgents(world);
 		}
 
 		// ask for process
-		return !someAlive;
+		return live == 0;
 	}
 
 	virtual void process() = 0;
 
+	// best individuals of the last processed generation (for island migration)
+	virtual std::vector<Weights> emigrants(size_t n) const = 0;
+
+	// migrants replace the tail of the population (fresh offspring in both EAs)
+	virtual void immigrate(const std::vector<Weights> &migrants) {
+		// never let migrants take over more than half of the population
+		const size_t count = std::min(migrants.size(), popSize / 2);
+
+		for (int m = 0; m < count; ++m) {
+			const size_t i = popSize - 1 - m;
+
+			populationW[i] = migrants[m];
+			population[i]->loadWeights(populationW[i]);
+		}
+	}
+
 	void saveEA(const std::string &path) const {
 		assert(std::filesystem::exists("saves") && "'saves' directory in build is missing!");
 
-		saveProcedure("saves/"+path+".json");
+		Checkpoint::write("saves/"+path+".ckpt", snapshot());
+		std::cout << typeName() << " saved to a checkpoint: " << "saves/"+path+".ckpt" << std::endl;
+
+		if (exportJson) {
+			saveProcedure("saves/"+path+".json");
+		}
+	};
+
+	// only the snapshot is taken here, the checkpoint gets written by the writer thread
+	// runnerState goes next to the EA's own state, latest names the run's pointer file
+	void saveEA(const std::string &path, CheckpointWriter &writer, const json &runnerState = json(), const std::string &latest = "") const {
+		assert(std::filesystem::exists("saves") && "'saves' directory in build is missing!");
+
+		// reuses a buffer of an already written snapshot when there is one
+		EASnapshot snap = writer.acquire();
+		takeSnapshot(snap);
+		if (!runnerState.is_null()) {
+			snap.state["runner"] = runnerState;
+		}
+		writer.submit("saves/"+path+".ckpt", std::move(snap), latest);
+
+		if (exportJson) {
+			saveProcedure("saves/"+path+".json");
+		}
 	};
 
+	size_t populationSize() const {
+		return popSize;
+	}
+
+	// live drone of the running episode with the best fitness so far, -1 once all are done.
+	// Cache hits and imputed individuals are never live - their drones don't leave the start
+	int leader() const {
+		int best = -1;
+		for (const uint32_t i : activeSet) {
+			if (best < 0 || fitness[i] > fitness[best]) best = i;
+		}
+		return best;
+	}
+
+	// name of the EA in saves (JSON "type", checkpoint header)
+	virtual std::string typeName() const = 0;
+
+	EASnapshot snapshot() const {
+		EASnapshot snap;
+		takeSnapshot(snap);
+		return snap;
+	}
+
+	// state of the run besides the population - with it a restored EA continues
+	// exactly like the original would have (RNG of the calling thread)
+	virtual json saveState() const {
+		std::ostringstream rng;
+		rng << gen;
+
+		json state = {
+			{"generation", generation},
+			{"fitnessStats", {lastFitnessStats.max, lastFitnessStats.min, lastFitnessStats.avg, lastFitnessStats.med}},
+			{"rng", rng.str()},
+			{"racingThreshold", racingThreshold},
+		};
+
+		// the novelty archive and the surrogate history are float blocks of the snapshot (fillSnapshotInfo)
+		if (surrogate) {
+			state["surrogate"] = surrogate->saveState();
+		}
+
+		return state;
+	}
+
+	virtual void loadState(const json &state) {
+		generation = state["generation"];
+
+		const json &stats = state["fitnessStats"];
+		lastFitnessStats = FitnessStats{stats[0], stats[1], stats[2], stats[3]};
+
+		std::istringstream rng(state["rng"].get<std::string>());
+		rng >> gen;
+
+		racingThreshold = state["racingThreshold"];
+
+		if (surrogate && state.contains("surrogate")) {
+			const json &s = state["surrogate"];
+			surrogate->loadState(s);
+
+			// version 2 checkpoints kept the history in the JSON state
+			if (s.contains("genomes")) {
+				surrogate->loadHistory(s["genomes"].get<std::vector<float>>(), s["fitness"].get<std::vector<float>>());
+			}
+		}
+		if (novelty && state.contains("noveltyArchive")) {
+			const auto archive = state["noveltyArchive"].get<std::vector<float>>();
+			novelty->loadArchive(archive.data(), archive.size());
+		}
+	}
+
+	// population + run state of a checkpoint (older checkpoints only have the population)
+	void restore(const CheckpointView &checkpoint) {
+		loadPopW(checkpoint);
+
+		const json state = checkpoint.state();
+		if (!state.is_null() && state.contains("ea")) {
+			loadState(state["ea"]);
+		}
+
+		// the large parts of the state come straight from the mapped file
+		if (checkpoint.header().version >= 3) {
+			if (novelty) {
+				const auto archive = checkpoint.block(SnapshotBlock::NoveltyArchive);
+				novelty->loadArchive(archive.data(), archive.size());
+			}
+			if (surrogate && !state.is_null() && state.contains("ea") && state["ea"].contains("surrogate")) {
+				surrogate->loadHistory(checkpoint.block(SnapshotBlock::SurrogateGenomes), checkpoint.block(SnapshotBlock::SurrogateFitness));
+			}
+		}
+	}
+
+	// withState = false - just the population (checkpoint history), the run state can be large
+	virtual void takeSnapshot(EASnapshot &snap, const bool withState = true) const {
+		fillSnapshotInfo(snap, withState);
+
+		for (int i = 0; i < popSize; ++i) {
+			std::copy(populationW[i].begin(), populationW[i].end(), snap.genome(i));
+		}
+	}
+
+	// a fresh episode of individual i on the world, frame by frame (video export) - the
+	// population's own drones and fitness are left alone
+	std::vector<TrajectoryFrame> recordEpisode(const size_t i, const World &world) {
+		assert(i < popSize && "Recorded individual is not in the population");
+
+		Drone drone{agents[i]->startPos};
+		std::vector<float> observation(input_size);
+		std::vector<float> episodeFitness{0};
+		RewardBatch rewards;
+
+		std::vector<TrajectoryFrame> frames;
+		bool alive = true;
+		while (alive) {
+			rewards.clear();
+			alive = stepAgent(&drone, population[i].get(), episodeFitness[0], dt, world, observation, rewards, 0, controlPeriod);
+			frames.push_back(TrajectoryFrame::capture(drone));
+		}
+
+		return frames;
+	}
+
 protected:
 	std::vector<Agent> agents;
 	std::vector<Individual> population;
 	std::vector<Weights> populationW;
 	std::vector<float> fitness;
 
+	// racing bookkeeping of the running generation
+	uint64_t episodeTick = 0;
+	std::vector<uint64_t> killTick; // 0 = not killed
+	RacingStats racingStats;
+	float racingThreshold = std::numeric_limits<float>::lowest(); // last generation's cutoff fitness
+
+	// indices of the drones still alive in the running generation (ascending)
+	std::vector<uint32_t> activeSet;
+	std::vector<uint32_t> liveCurve;
+
+	// goal deltas of the live drones, filled by stepAgent during the tick
+	RewardBatch rewards;
+
+	// phase times of the sampled drone ticks
+	PhaseTimes sampledTimes;
+	uint64_t phaseCounter = 0;
+
+	// fitness cache bookkeeping of the running generation
+	bool episodeCacheable = false;
+	uint64_t episodeWorldKey = 0;
+	std::vector<uint8_t> fromCache;
+	CacheStats cacheStats;
+
+	// surrogate bookkeeping of the running generation
+	std::vector<uint8_t> imputed;
+	std::vector<float> predicted;
+	bool episodeScreened = false;
+	SurrogateStats surrogateStats;
+
 	const size_t popSize;
 	const json motherDescription;
+
+	void fillSnapshotInfo(EASnapshot &snap, const bool withState) const {
+		snap.type = typeName();
+		snap.generation = generation;
+		snap.motherDescription = motherDescription;
+		snap.setLayout(popSize, populationW[0].size());
+		snap.state = withState ? json{{"ea", saveState()}} : json();
+
+		// the buffers keep their capacity in reused snapshots
+		for (auto && block : snap.blocks) {
+			block.clear();
+		}
+		if (withState && novelty) {
+			snap.block(SnapshotBlock::NoveltyArchive).assign(novelty->archiveData().begin(), novelty->archiveData().end());
+		}
+		if (withState && surrogate) {
+			surrogate->saveHistory(snap.block(SnapshotBlock::SurrogateGenomes), snap.block(SnapshotBlock::SurrogateFitness));
+		}
+	}
 	
 	friend class Loader;
 
+	// single simulation tick of one agent (physics, goal collection, control)
+	// the goal bonus goes straight to fitness, the shaping reward is pushed to the batch under id
+	// returns false once the drone is dead, times (optional) collects the sensors and inference time
+	static bool stepAgent(Drone *drone, Net *net, float &fitness, const float dt, const World &world, std::vector<float> &observation,
+						  RewardBatch &rewards, const uint32_t id, const uint64_t controlPeriod=1, bool debug=false,
+						  PhaseTimes *times=nullptr) {
+		drone->update(dt, world);
+
+		if (!drone->alive) return false;
+
+		// observation + inference only on control ticks (the first tick always is one)
+		assert(controlPeriod > 0 && "Control period has to be at least one tick");
+		const bool controlTick = (drone->ticks - 1) % controlPeriod == 0;
+		if (controlTick) {
+			const auto start = times ? PhaseTimes::Clock::now() : PhaseTimes::Clock::time_point();
+
+			drone->genObservation_with_sensors(observation, world);
+			/* drone->genObservation_no_sensors(observation, world); */
+
+			if (times) times->sensors += PhaseTimes::since(start) - PhaseTimes::clockCost();
+		}
+
+		// hard-coded goal collection
+		sf::Vector2f goalDist = world.goals[drone->goalIndex % world.goals.size()] - drone->pos;
+		if (goalDist.x*goalDist.x + goalDist.y*goalDist.y < 100) {
+			drone->goalTimer += 1;
+			// half a second for 60 fps game physics - GOAL COLLECTED
+			if (drone->goalTimer > 30) {
+				drone->goalTimer = 0;
+				drone->goalIndex += 1;
+				drone->goalVisits.push_back(drone->ticks);
+
+				// reward for quickly obtaining the goal
+				fitness += (drone->goalIndex+1)*(600 - drone->aliveTimer);
+				drone->aliveTimer *= 0.5f;
+			}
+		}
+		else {
+			drone->goalTimer = 0;
+		}
+
+		// fitness calculation (batched, see RewardBatch)
+		rewards.push(id, goalDist.x/world.boundary.x, goalDist.y/world.boundary.y, drone->goalIndex+1);
+
+		if (!controlTick) return true;
+
+		if (debug) {
+			std::cout << "DEBUG:" << std::endl;
+			std::cout << "GD: " << goalDist.x/world.boundary.x << "," << goalDist.y/world.boundary.y << std::endl;
+			std::cout << "FGD: " << (drone->goalIndex+1)*RewardBatch::shaping(goalDist.x/world.boundary.x, goalDist.y/world.boundary.y) << std::endl;
+			std::cout << "Sensors: ["; 
+			for (int i = 0; i < 8; ++i) {
+				std::cout << observation[5+i] << ", ";
+			}
+			std::cout << "]" << std::endl;
+
+			std::cout << "velx: " << observation[0] << ", vely: " << observation[1] << std::endl;
+			std::cout << "cAngle: " << observation[2] << ", sAngle: " << observation[3] << std::endl;
+			std::cout << "avel: " << observation[4] << std::endl;
+		}
+
+		const auto start = times ? PhaseTimes::Clock::now() : PhaseTimes::Clock::time_point();
+
+		Output output = net->predict(observation);
+		assert(output.size() == 4 && "Drone expects 4 net outputs");
+		drone->control(output[0], output[1], output[2], output[3]);
+
+		if (times) times->inference += PhaseTimes::since(start) - PhaseTimes::clockCost();
+
+		return true;
+	}
+
+	// one tick of the live drones, the dead ones get compacted out of the set - returns how many live on
+	template <bool Record>
+	size_t stepActive(const float dt, const World &world, std::vector<float> &observation, const bool debug) {
+		size_t live = 0;
+		for (size_t a = 0; a < activeSet.size(); ++a) {
+			const uint32_t i = activeSet[a];
+			PhaseTimes *times = (timePhases && ++phaseCounter % phaseSampling == 0) ? &sampledTimes : nullptr;
+
+			const bool alive = stepAgent(agents[i].get(), population[i].get(), fitness[i], dt, world, observation, rewards, i, controlPeriod, debug && i == 0, times);
+			if constexpr (Record) {
+				trajectories->capture(i, *agents[i]);
+			}
+
+			if (alive) {
+				activeSet[live++] = i;
+			}
+		}
+		activeSet.resize(live);
+
+		return live;
+	}
+
+	// first tick of a generation - individuals with a known outcome on this world are done already
+	void beginEpisode(const World &world) {
+		fromCache.assign(popSize, false);
+		cacheStats = CacheStats();
+
+		episodeCacheable = fitnessCache && world.isStatic;
+		if (episodeCacheable) {
+			// the outcome also depends on how often the controller is queried
+			episodeWorldKey = hashBytes(&controlPeriod, sizeof(controlPeriod), hashWorld(world));
+			for (int i = 0; i < popSize; ++i) {
+				cacheStats.lookups += 1;
+
+				const EpisodeOutcome *known = fitnessCache->find(populationW[i], episodeWorldKey, generation);
+				if (!known) continue;
+
+				known->restore(*agents[i]);
+				fitness[i] = known->fitness;
+				fromCache[i] = true;
+				cacheStats.hits += 1;
+			}
+		}
+
+		imputed.assign(popSize, false);
+		if (surrogate) {
+			screenAgents();
+		}
+
+		activeSet.clear();
+		for (int i = 0; i < popSize; ++i) {
+			if (agents[i]->alive) activeSet.push_back(i);
+		}
+
+		liveCurve.clear();
+
+		if (trajectories) {
+			trajectories->beginGeneration(world);
+		}
+	}
+
+	void storeEpisodes() {
+		for (int i = 0; i < popSize; ++i) {
+			// raced drones did not finish their episode, imputed ones never started it
+			if (fromCache[i] || imputed[i] || killTick[i] != 0) continue;
+
+			fitnessCache->store(populationW[i], episodeWorldKey, generation, EpisodeOutcome::record(*agents[i], fitness[i]));
+		}
+
+		fitnessCache->prune(generation);
+		lastCacheStats = cacheStats;
+	}
+
+	// individuals that still need an episode are ranked by the surrogate,
+	// everything below the simulated fraction is marked dead before the first tick
+	void screenAgents() {
+		surrogateStats = SurrogateStats();
+		predicted.assign(popSize, 0);
+		episodeScreened = false;
+
+		std::vector<uint32_t> candidates;
+		for (int i = 0; i < popSize; ++i) {
+			if (!fromCache[i]) candidates.push_back(i);
+		}
+		surrogateStats.simulated = candidates.size();
+
+		// not enough history yet - everything gets simulated
+		if (!surrogate->ready()) return;
+
+		for (const uint32_t i : candidates) {
+			predicted[i] = surrogate->predict(populationW[i]);
+		}
+		episodeScreened = true;
+
+		const size_t keep = std::ceil(surrogate->config.simulateFraction * candidates.size());
+		std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b){return predicted[a] > predicted[b];});
+
+		for (size_t c = keep; c < candidates.size(); ++c) {
+			imputed[candidates[c]] = true;
+			agents[candidates[c]]->alive = false;
+		}
+
+		surrogateStats.simulated = keep;
+		surrogateStats.imputed = candidates.size() - keep;
+	}
+
+	// imputed individuals get their prediction, capped by the worst simulated fitness -
+	// the surrogate only decides what is not worth an episode, it never outranks a real one.
+	// Finished episodes then train the surrogate.
+	void imputeFitness() {
+		float worstSimulated = std::numeric_limits<float>::max();
+		for (int i = 0; i < popSize; ++i) {
+			if (!imputed[i]) worstSimulated = std::min(worstSimulated, fitness[i]);
+		}
+
+		float errorSum = 0;
+		size_t errorCount = 0;
+		for (int i = 0; i < popSize; ++i) {
+			if (imputed[i]) {
+				fitness[i] = std::min(predicted[i], worstSimulated);
+				continue;
+			}
+
+			// cached outcomes are in the history already, raced drones did not finish
+			if (fromCache[i] || killTick[i] != 0) continue;
+
+			if (episodeScreened) {
+				errorSum += std::abs(predicted[i] - fitness[i]);
+				errorCount += 1;
+			}
+
+			surrogate->add(populationW[i], fitness[i]);
+		}
+
+		surrogateStats.meanAbsError = errorCount ? errorSum / errorCount : 0;
+		lastSurrogateStats = surrogateStats;
+	}
+
+	// final fitness of the finished generation (goal bonus), its stats and (with novelty
+	// search or multi-objective selection on) the score the EAs then select by
+	void finalizeFitness() {
+		if (episodeCacheable) {
+			storeEpisodes();
+		}
+
+		lastLiveStats.ticks = liveCurve.size();
+		lastLiveStats.steps = std::accumulate(liveCurve.begin(), liveCurve.end(), uint64_t(0));
+		lastLiveStats.meanLiveFraction = (float)lastLiveStats.steps / std::max<uint64_t>(1, lastLiveStats.ticks * popSize);
+		lastLiveCurve.swap(liveCurve);
+
+		for (int i = 0; i < popSize; ++i) {
+			fitness[i] += 1000 * agents[i]->goalIndex;
+		}
+
+		if (surrogate) {
+			imputeFitness();
+		}
+
+		// stats always describe the objective fitness, not the blend - and only finished episodes,
+		// the partial fitness of raced drones would move min/avg/med (their count is in lastRacingStats)
+		std::vector<float> sorted;
+		sorted.reserve(popSize);
+		for (int i = 0; i < popSize; ++i) {
+			if (killTick[i] == 0) sorted.push_back(fitness[i]);
+		}
+		if (sorted.empty()) sorted = fitness;
+
+		const size_t n = sorted.size();
+		const float fitnessSum = std::accumulate(sorted.begin(), sorted.end(), 0.0f);
+		std::nth_element(sorted.begin(), sorted.begin() + (n-1) - n/2, sorted.end());
+
+		lastFitnessStats.max = *std::max_element(sorted.begin(), sorted.end());
+		lastFitnessStats.min = *std::min_element(sorted.begin(), sorted.end());
+		lastFitnessStats.med = sorted[(n-1) - n/2];
+		lastFitnessStats.avg = fitnessSum / n;
+
+		// before novelty/multi-objective replace the fitness - the best are the best by the objective
+		if (trajectories) {
+			trajectories->endGeneration(generation, fitness);
+		}
+
+		if (racing != RacingMode::Off) {
+			finishRacing(fitness);
+		}
+
+		if (novelty) {
+			novelty->apply(agents, fitness);
+		}
+
+		if (multiObjective) {
+			multiObjective->apply(agents, imputed, fitness);
+		}
+	}
+
+	// how many of the best individuals the EA selects (racing keeps all of them intact)
+	virtual size_t selectionSize() const {
+		return popSize;
+	}
+
+	// true when breeding also depends on the fitness below the selection (ranks, the worst one) -
+	// killed drones would change it, so Exact racing can't promise an unchanged selection
+	virtual bool selectionUsesAllRanks() const {
+		return false;
+	}
+
+	// upper bound of the final fitness (goal bonus incl.) a drone can still reach,
+	// from the reward terms in stepAgent:
+	// - every tick pays at most goalIndex+1 (cosG <= 1)
+	// - a goal pays (goalIndex+1)*(600 - aliveTimer) + 1000 and needs 31 ticks in its radius,
+	//   it cannot be collected before the drone could have flown there
+	// - a drone lives until aliveTimer > 600, every goal can buy at most 300 more ticks
+	// - it dies after goal 2*goals
+	static float fitnessUpperBound(const Drone &drone, const float fitness, const World &world) {
+		const float reached = fitness + 1000 * drone.goalIndex;
+		if (!drone.alive) return reached;
+
+		// the fastest a drone can change its velocity (both thrusters at full power + gravity)
+		const float maxAccel = (drone.thrusterLeft.maxPower + drone.thrusterRight.maxPower + 10.0f) * dt;
+		const float speed = dist(drone.vel);
+
+		const uint64_t a = std::min<uint64_t>(drone.aliveTimer, 600);
+		const uint64_t g = drone.goalIndex;
+		const size_t G = world.goals.size();
+		const uint64_t maxGoals = 2*G + 1;
+
+		// earliest tick (from now) of collection j: W ticks have to be spent in goal radii and
+		// the rest of the ticks have to cover the distance C at no more than speed + maxAccel*tick
+		auto earliest = [&](float W, float C) -> uint64_t {
+			if (C <= 0) return W;
+			// (T - W)*(speed + maxAccel*T) >= C
+			const float B = speed - W*maxAccel;
+			const float T = (-B + std::sqrt(B*B + 4*maxAccel*(C + W*speed))) / (2*maxAccel);
+			return std::max<float>(W, std::floor(T));
+		};
+
+		const bool inGoal = drone.goalTimer > 0;
+		float W = inGoal ? 31 - std::min<uint64_t>(drone.goalTimer, 30) : 30;
+		float C = inGoal ? 0 : dist(world.goals[g % G] - drone.pos) - 10;
+
+		float bound = reached;
+		uint64_t lifeLeft = 600 - a;
+		uint64_t rate = g + 1; // goalIndex+1 of the current reward segment
+		uint64_t tick = 0;     // ticks accounted for so far
+		uint64_t lastCollect = 0;
+
+		for (uint64_t c = g; c < maxGoals; ++c) {
+			const uint64_t T = earliest(W, C);
+			if (T > lifeLeft) break;
+
+			// ticks before the collection still pay the old rate, the collection tick the new one
+			bound += rate * (T - 1 - tick);
+			tick = T - 1;
+			rate += 1;
+
+			const uint64_t timer = (c == g) ? a + T : T - lastCollect;
+			bound += rate * (600.0f - std::min<uint64_t>(timer, 600)) + 1000;
+			lastCollect = T;
+
+			lifeLeft += 300;
+			W += 30;
+			C += std::max(0.0f, dist(world.goals[(c+1) % G] - world.goals[c % G]) - 20);
+		}
+
+		// rest of the (longest possible) life at the final rate
+		bound += rate * (lifeLeft - tick);
+
+		return bound;
+	}
+
+	// kills drones whose upper bound is below the cutoff
+	void raceAgents(const World &world) {
+		// selection on a novelty blend or on Pareto ranks has no fitness cutoff to race against
+		if (novelty || multiObjective) return;
+
+		assert(!(racing == RacingMode::Exact && selectionUsesAllRanks()) && "Exact racing would change the selection of this EA");
+
+		const size_t K = selectionSize();
+		if (K == 0 || K >= popSize) return;
+
+		// final fitness never decreases, so what a drone already has is a lower bound -
+		// a drone below K lower bounds can never make the top K
+		std::vector<float> lower(popSize);
+		for (int i = 0; i < popSize; ++i) {
+			lower[i] = fitness[i] + 1000 * agents[i]->goalIndex;
+		}
+		std::nth_element(lower.begin(), lower.begin() + (K-1), lower.end(), std::greater<float>());
+
+		float cutoff = lower[K-1];
+		if (racing == RacingMode::Threshold) {
+			cutoff = std::max(cutoff, racingThreshold);
+		}
+
+		for (const uint32_t i : activeSet) {
+			Drone *drone = agents[i].get();
+
+			if (fitnessUpperBound(*drone, fitness[i], world) < cutoff) {
+				drone->alive = false;
+				killTick[i] = episodeTick;
+			}
+		}
+	}
+
+	void finishRacing(const std::vector<float> &finalFitness) {
+		racingStats.killed = 0;
+		racingStats.savedSteps = 0;
+		for (int i = 0; i < popSize; ++i) {
+			if (killTick[i] == 0) continue;
+
+			racingStats.killed += 1;
+			racingStats.savedSteps += episodeTick - killTick[i];
+		}
+		lastRacingStats = racingStats;
+
+		const size_t K = std::min(selectionSize(), popSize);
+		std::vector<float> sorted(finalFitness);
+		std::nth_element(sorted.begin(), sorted.begin() + (K-1), sorted.end(), std::greater<float>());
+		racingThreshold = sorted[K-1];
+	}
+
+	// full episode of a single individual, returns its final fitness (incl. goal bonus)
+	static float evaluateEpisode(Net &net, Drone &drone, const World &world, std::vector<float> &observation, const uint64_t controlPeriod=1) {
+		drone.reset();
+
+		std::vector<float> episodeFitness{0};
+		RewardBatch rewards;
+
+		bool alive = true;
+		while (alive) {
+			rewards.clear();
+			alive = stepAgent(&drone, &net, episodeFitness[0], dt, world, observation, rewards, 0, controlPeriod);
+			rewards.apply(episodeFitness);
+		}
+
+		return episodeFitness[0] + 1000 * drone.goalIndex;
+	}
+
 	// base from EasyEA
 	virtual void initPop(const Net &mother) {
 		for (int i = 0; i < popSize; ++i) {
@@ -173,7 +872,11 @@ protected:
 			agents[i]->reset();
 			population[i]->loadWeights(populationW[i]);
 			fitness[i] = 0;
+			killTick[i] = 0;
 		}
+
+		episodeTick = 0;
+		racingStats = RacingStats();
 	}
 
 	virtual std::vector<size_t> fitnessAgents() = 0;
@@ -184,6 +887,44 @@ protected:
 			populationW[i] = Weights(config["popW"][std::to_string(i)]);
 		}
 
+		populationLoaded();
 		this->resetAgents();
 	};
+
+	virtual void loadPopW(const CheckpointView &checkpoint) {
+		const CheckpointHeader &header = checkpoint.header();
+		assert(header.popSize == popSize && "Checkpoint population size does not match the EA");
+		// a shorter genome than the net has weights would be read past its end by Net::loadWeights
+		if (header.genomeSize != populationW[0].size()) {
+			throw std::runtime_error("Checkpoint genome size " + std::to_string(header.genomeSize) + " does not match the net (" +
+									 std::to_string(populationW[0].size()) + " weights)");
+		}
+
+		for (int i = 0; i < popSize; ++i) {
+			const float *w = checkpoint.genome(i);
+			populationW[i].assign(w, w + header.genomeSize);
+		}
+
+		populationLoaded();
+		this->resetAgents();
+	}
+
+	virtual void loadPopW(const EASnapshot &snap) {
+		assert(snap.popSize == popSize && "Snapshot population size does not match the EA");
+		if (snap.genomeSize != populationW[0].size()) {
+			throw std::runtime_error("Snapshot genome size " + std::to_string(snap.genomeSize) + " does not match the net (" +
+									 std::to_string(populationW[0].size()) + " weights)");
+		}
+
+		for (int i = 0; i < popSize; ++i) {
+			const float *w = snap.genome(i);
+			populationW[i].assign(w, w + snap.genomeSize);
+		}
+
+		populationLoaded();
+		this->resetAgents();
+	}
+
+	// derived EAs sync their own structures to a loaded populationW
+	virtual void populationLoaded() {}
 };
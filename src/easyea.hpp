@@ -4,6 +4,9 @@
 
 struct EasyEA : public AbstractEA {
 
+	// chance of a weight being replaced by a new random one (a sweep sets it right after construction)
+	float mutationProb = 0.025f;
+
 	EasyEA(size_t popSize, const Net &mother, const Drone &father) : AbstractEA(popSize, mother, father) { 
 		initPop(mother);
 		initAgents(father);
@@ -11,7 +14,7 @@ struct EasyEA : public AbstractEA {
 
 	// PROCESS WITHOUT CROSSOVER
 	void process() override {
-		std::cout << "EasyEA Process Without crossover" << std::endl;
+		if (verbose) std::cout << "EasyEA Process Without crossover" << std::endl;
 		auto elite = fitnessAgents();
 
 		std::vector<Weights> eliteW;
@@ -19,7 +22,6 @@ struct EasyEA : public AbstractEA {
 			eliteW.push_back(populationW[i]);
 		}
 
-		const float factor = 0.25;
 		auto selectedIds = top_n(popSize*factor);
 		auto offspringWeights = popUpscaling(selectedIds, 1.0/factor);
 		mutation(offspringWeights);
@@ -36,6 +38,28 @@ struct EasyEA : public AbstractEA {
 		resetAgents();
 	}
 
+	std::vector<Weights> emigrants(size_t n) const override {
+		const size_t eliteSize = popSize*eliteFactor;
+		n = std::min(n, eliteSize);
+
+		// process() keeps the best at 0 and the rest of the elite behind the upscaled block
+		std::vector<Weights> best;
+		best.reserve(n);
+		for (int i = 0; i < n; ++i) {
+			best.push_back(populationW[(i == 0) ? 0 : popSize*factor + i]);
+		}
+
+		return best;
+	}
+
+	size_t selectionSize() const override {
+		return popSize*factor;
+	}
+
+	std::string typeName() const override {
+		return "EasyEA";
+	}
+
 	void saveProcedure(const std::string &path) const override {
 		json popW;
 
@@ -58,17 +82,16 @@ struct EasyEA : public AbstractEA {
 	}
 
 private:
+	static constexpr float factor = 0.25;
+	static constexpr float eliteFactor = 0.05;
+
 	// return an elite vector
 	std::vector<size_t> fitnessAgents() override {
 		std::vector<size_t> eliteIds;
 
-		float fitnessSum = 0;
-		for (int i = 0; i < popSize; ++i) {
-			fitness[i] += 1000 * agents[i]->goalIndex;
-			fitnessSum += fitness[i];
-		}
+		finalizeFitness();
 
-		const int eliteSize = popSize*0.05;
+		const int eliteSize = popSize*eliteFactor;
 
 		std::vector<size_t> idx(popSize);
 		std::iota(idx.begin(), idx.end(), 0);
@@ -79,11 +102,6 @@ private:
 			eliteIds.push_back(idx[i]);
 		}
 
-		lastFitnessStats.max = fitness[idx[0]];
-		lastFitnessStats.min = fitness[idx[popSize-1]];
-		lastFitnessStats.med = fitness[idx[popSize/2]];
-		lastFitnessStats.avg = fitnessSum / popSize;;
-
 		return eliteIds;
 	}
 
@@ -235,7 +253,7 @@ private:
 		std::uniform_real_distribution<float> weightDistr(-1.0f, 1.0f);
 		std::uniform_real_distribution<float> chanceDistr(0.0f, 1.0f);
 
-		const float MUTPROB = 0.025;
+		const float MUTPROB = mutationProb;
 
 		for (int i = 0; i < popSize; ++i) {
 			for (int k = 0; k < offspringW[i].size(); ++k) {
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "drone.hpp"
+#include "net.hpp"
+#include "utils.hpp"
+
+// FNV-1a over raw bytes
+inline uint64_t hashBytes(const void *data, size_t size, uint64_t hash = 14695981039346656037ull) {
+	const uint8_t *bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+inline uint64_t hashGenome(const Weights &w) {
+	return hashBytes(w.data(), w.size() * sizeof(float));
+}
+
+// identity of a world layout - two worlds with the same walls and goals simulate the same
+inline uint64_t hashWorld(const World &world) {
+	uint64_t hash = hashBytes(&world.boundary, sizeof(world.boundary));
+	for (auto && w : world.walls) {
+		hash = hashBytes(&w.pos, sizeof(w.pos), hash);
+		hash = hashBytes(&w.radius, sizeof(w.radius), hash);
+	}
+	for (auto && g : world.goals) {
+		hash = hashBytes(&g, sizeof(g), hash);
+	}
+	return hash;
+}
+
+// everything the EA reads from a finished episode
+struct EpisodeOutcome {
+	float fitness = 0; // accumulated reward, before the goal bonus
+	size_t goalIndex = 0;
+	uint64_t ticks = 0;
+	uint64_t aliveTimer = 0;
+	sf::Vector2f pos;
+	float angle = 0;
+	std::vector<uint64_t> goalVisits;
+	float energy = 0;
+
+	static EpisodeOutcome record(const Drone &drone, const float fitness) {
+		return EpisodeOutcome{fitness, drone.goalIndex, drone.ticks, drone.aliveTimer, drone.pos, drone.angle, drone.goalVisits, drone.energy};
+	}
+
+	// puts the drone into its final (dead) state as if it had just been simulated
+	void restore(Drone &drone) const {
+		drone.goalIndex = goalIndex;
+		drone.ticks = ticks;
+		drone.aliveTimer = aliveTimer;
+		drone.pos = pos;
+		drone.angle = angle;
+		drone.goalVisits = goalVisits;
+		drone.energy = energy;
+		drone.alive = false;
+	}
+};
+
+struct CacheStats {
+	uint64_t lookups = 0;
+	uint64_t hits = 0;
+};
+
+// Episode outcomes of genomes on static worlds. The physics is deterministic there,
+// so the same genome on the same world always ends the same way. The world key also
+// has to cover the simulation settings the outcome depends on (the EA adds controlPeriod).
+struct FitnessCache {
+	// entries not used for this many generations get dropped
+	const uint64_t maxAge;
+
+	FitnessCache(uint64_t maxAge = 2) : maxAge(maxAge) {}
+
+	const EpisodeOutcome* find(const Weights &genome, const uint64_t worldKey, const uint64_t generation) {
+		auto it = entries.find(key(genome, worldKey));
+		if (it == entries.end()) return nullptr;
+
+		Entry &e = it->second;
+		// full comparison - a hash collision must never hand out a wrong fitness
+		if (e.worldKey != worldKey || e.genome.size() != genome.size() ||
+			std::memcmp(e.genome.data(), genome.data(), genome.size() * sizeof(float)) != 0) {
+			return nullptr;
+		}
+
+		e.lastUsed = generation;
+		return &e.outcome;
+	}
+
+	void store(const Weights &genome, const uint64_t worldKey, const uint64_t generation, EpisodeOutcome &&outcome) {
+		entries[key(genome, worldKey)] = Entry{genome, worldKey, generation, std::move(outcome)};
+	}
+
+	void prune(const uint64_t generation) {
+		std::erase_if(entries, [&](const auto &item) { return item.second.lastUsed + maxAge < generation; });
+	}
+
+	size_t size() const {
+		return entries.size();
+	}
+
+private:
+	struct Entry {
+		Weights genome;
+		uint64_t worldKey;
+		uint64_t lastUsed;
+		EpisodeOutcome outcome;
+	};
+
+	std::unordered_map<uint64_t, Entry> entries;
+
+	static uint64_t key(const Weights &genome, const uint64_t worldKey) {
+		return hashGenome(genome) ^ (worldKey * 0x9E3779B97F4A7C15ull);
+	}
+};
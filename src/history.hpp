@@ -0,0 +1,654 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "checkpoint.hpp"
+
+// Delta coding of a population against the previously stored one.
+//
+// Between two stored generations nearly every gene is a copy of a gene at the same position
+// of the previous population - elites and carried-over parents whole, upscaled parents up to
+// their mutations, crossover offspring from two parents, CoSyNE permutations from any row.
+// Only mutated genes are new values.
+//
+// Payload of a delta:
+//   lineage           popSize indices - the previous row a genome took most genes from (its parent)
+//   popSize records   uint8 mode: 0 = exact copy of the parent, done
+//                                 1 = coded: index partner, 2 bits per gene, then the value stream
+//                     gene codes: 0 = parent's gene, 1 = partner's gene,
+//                                 2 = gene of another row (next index in the stream), 3 = new value (next float)
+// Payload of a keyframe: lineage + the dense weights.
+//
+// Lineage/partner indices take 2 bytes below 65535 individuals, 4 above, noRow is all ones.
+// References in the value stream never are noRow and take 1 byte up to 256 individuals -
+// CoSyNE permutes most genes of the weaker part of the population, those are most of a delta.
+struct HistoryCodec {
+	static constexpr uint32_t noRow = 0xFFFFFFFF;
+
+	static size_t indexBytes(const size_t popSize) {
+		return (popSize < 0xFFFF) ? 2 : 4;
+	}
+
+	static size_t refBytes(const size_t popSize) {
+		return (popSize <= 0x100) ? 1 : indexBytes(popSize);
+	}
+
+	// prev/next - popSize * genomeSize floats, lineage gets the parent of every genome
+	// (prev = nullptr - nothing to refer to, the lineage is all noRow)
+	static void encodeDelta(const float *prev, const float *next, const size_t popSize, const size_t genomeSize,
+							std::vector<uint8_t> &out, std::vector<uint32_t> &lineage) {
+		const size_t w = indexBytes(popSize);
+		const size_t rw = refBytes(popSize);
+		lineage.assign(popSize, noRow);
+
+		std::vector<uint32_t> source(genomeSize);
+		std::vector<uint32_t> partnerOf(popSize, noRow);
+		std::vector<uint32_t> votes(popSize, 0);
+		std::vector<uint32_t> touched;
+
+		// column index of prev - (value bits << 32 | row), sorted per gene
+		std::vector<uint64_t> column;
+		if (prev) {
+			column.resize(genomeSize * popSize);
+			for (size_t k = 0; k < genomeSize; ++k) {
+				uint64_t *c = &column[k * popSize];
+				for (size_t r = 0; r < popSize; ++r) {
+					c[r] = (uint64_t(bits(prev[r*genomeSize + k])) << 32) | r;
+				}
+				std::sort(c, c + popSize);
+			}
+		}
+
+		// lowest row of prev with this value at gene k
+		auto find = [&](const size_t k, const uint32_t value) {
+			const uint64_t *c = &column[k * popSize];
+			const uint64_t *it = std::lower_bound(c, c + popSize, uint64_t(value) << 32);
+			return (it != c + popSize && (*it >> 32) == value) ? uint32_t(*it) : noRow;
+		};
+
+		// the row most of the listed genes come from
+		auto mostVoted = [&](auto &&counts) {
+			uint32_t best = noRow;
+			for (const uint32_t r : touched) {
+				if (counts[r] > 0 && (best == noRow || counts[r] > counts[best] || (counts[r] == counts[best] && r < best))) best = r;
+			}
+			for (const uint32_t r : touched) counts[r] = 0;
+			touched.clear();
+			return best;
+		};
+
+		for (size_t i = 0; i < popSize && prev; ++i) {
+			const float *g = next + i*genomeSize;
+
+			for (size_t k = 0; k < genomeSize; ++k) {
+				source[k] = find(k, bits(g[k]));
+				if (source[k] != noRow && votes[source[k]]++ == 0) touched.push_back(source[k]);
+			}
+			const uint32_t parent = mostVoted(votes);
+
+			if (parent != noRow) {
+				const float *p = prev + parent*genomeSize;
+				for (size_t k = 0; k < genomeSize; ++k) {
+					if (bits(g[k]) != bits(p[k]) && source[k] != noRow && votes[source[k]]++ == 0) touched.push_back(source[k]);
+				}
+			}
+
+			lineage[i] = parent;
+			partnerOf[i] = mostVoted(votes);
+		}
+
+		out.clear();
+		for (size_t i = 0; i < popSize; ++i) {
+			putIndex(out, lineage[i], w);
+		}
+
+		std::vector<uint8_t> codes((genomeSize + 3) / 4);
+		std::vector<uint8_t> stream;
+		for (size_t i = 0; i < popSize; ++i) {
+			const float *g = next + i*genomeSize;
+			const float *p = (lineage[i] != noRow) ? prev + lineage[i]*genomeSize : nullptr;
+			const float *q = (partnerOf[i] != noRow) ? prev + partnerOf[i]*genomeSize : nullptr;
+
+			std::fill(codes.begin(), codes.end(), 0);
+			stream.clear();
+			bool copy = (p != nullptr);
+
+			for (size_t k = 0; k < genomeSize; ++k) {
+				const uint32_t value = bits(g[k]);
+
+				uint8_t code;
+				if (p && value == bits(p[k])) {
+					code = 0;
+				}
+				else if (q && value == bits(q[k])) {
+					code = 1;
+				}
+				else if (prev && (source[k] = find(k, value)) != noRow) {
+					code = 2;
+					putIndex(stream, source[k], rw);
+				}
+				else {
+					code = 3;
+					putFloat(stream, g[k]);
+				}
+
+				copy &= (code == 0);
+				codes[k / 4] |= code << (2 * (k % 4));
+			}
+
+			if (copy) {
+				out.push_back(0);
+				continue;
+			}
+
+			out.push_back(1);
+			putIndex(out, partnerOf[i], w);
+			out.insert(out.end(), codes.begin(), codes.end());
+			out.insert(out.end(), stream.begin(), stream.end());
+		}
+	}
+
+	// inverse of encodeDelta, returns the bytes consumed
+	static size_t decodeDelta(const float *prev, const uint8_t *data, const size_t size, const size_t popSize, const size_t genomeSize, float *next) {
+		const size_t w = indexBytes(popSize);
+		const size_t rw = refBytes(popSize);
+		const uint8_t *p = data;
+		const uint8_t *end = data + size;
+
+		const uint8_t *lineage = p;
+		check(popSize * w <= size);
+		p += popSize * w;
+
+		for (size_t i = 0; i < popSize; ++i) {
+			const uint8_t *l = lineage + i*w;
+			const uint32_t parent = getIndex(l, w);
+			float *g = next + i*genomeSize;
+
+			check(p < end);
+			const uint8_t mode = *p++;
+
+			if (mode == 0) {
+				check(parent < popSize);
+				std::memcpy(g, prev + parent*genomeSize, genomeSize * sizeof(float));
+				continue;
+			}
+
+			check(mode == 1 && p + w <= end);
+			const uint32_t partner = getIndex(p, w);
+			check(p + (genomeSize + 3) / 4 <= end);
+			const uint8_t *codes = p;
+			p += (genomeSize + 3) / 4;
+
+			for (size_t k = 0; k < genomeSize; ++k) {
+				const uint8_t code = (codes[k / 4] >> (2 * (k % 4))) & 3;
+				uint32_t row = noRow;
+
+				switch (code) {
+					case 0: row = parent; break;
+					case 1: row = partner; break;
+					case 2: check(p + rw <= end); row = getIndex(p, rw); break;
+					case 3: check(p + sizeof(float) <= end); std::memcpy(&g[k], p, sizeof(float)); p += sizeof(float); continue;
+				}
+
+				check(row < popSize);
+				g[k] = prev[row*genomeSize + k];
+			}
+		}
+
+		check(p <= end);
+		return p - data;
+	}
+
+	// parent rows stored at the front of every payload
+	static std::vector<uint32_t> decodeLineage(const uint8_t *data, const size_t size, const size_t popSize) {
+		const size_t w = indexBytes(popSize);
+		check(popSize * w <= size);
+		std::vector<uint32_t> lineage(popSize);
+		for (size_t i = 0; i < popSize; ++i) {
+			lineage[i] = getIndex(data, w);
+		}
+		return lineage;
+	}
+
+	static void putIndex(std::vector<uint8_t> &out, const uint32_t value, const size_t w) {
+		if (w == 1) {
+			assert(value < 0x100 && "1 byte indices are only for stream references");
+			out.push_back(value);
+		}
+		else if (w == 2) {
+			const uint16_t v = (value == noRow) ? 0xFFFF : value;
+			out.insert(out.end(), reinterpret_cast<const uint8_t*>(&v), reinterpret_cast<const uint8_t*>(&v) + 2);
+		}
+		else {
+			out.insert(out.end(), reinterpret_cast<const uint8_t*>(&value), reinterpret_cast<const uint8_t*>(&value) + 4);
+		}
+	}
+
+	static uint32_t getIndex(const uint8_t *&p, const size_t w) {
+		if (w == 1) {
+			return *p++;
+		}
+		if (w == 2) {
+			uint16_t v;
+			std::memcpy(&v, p, 2);
+			p += 2;
+			return (v == 0xFFFF) ? noRow : v;
+		}
+
+		uint32_t v;
+		std::memcpy(&v, p, 4);
+		p += 4;
+		return v;
+	}
+
+	static void putFloat(std::vector<uint8_t> &out, const float value) {
+		out.insert(out.end(), reinterpret_cast<const uint8_t*>(&value), reinterpret_cast<const uint8_t*>(&value) + sizeof(float));
+	}
+
+	// genes are compared bit for bit (-0 != 0, NaN == NaN)
+	static uint32_t bits(const float value) {
+		uint32_t b;
+		std::memcpy(&b, &value, sizeof(b));
+		return b;
+	}
+
+private:
+	static void check(const bool ok) {
+		if (!ok) throw std::runtime_error("Corrupted checkpoint history record");
+	}
+};
+
+// Checkpoint history of a run - many generations for post-hoc analysis at a fraction
+// of the size of full checkpoints.
+//
+//   <path>.hist   [HistoryHeader][mother net description][records ...]   append only
+//   <path>.idx    [magic, version][HistoryEntry ...]                     one entry per record
+//
+// Every keyframeInterval-th record is a keyframe (full weights), the ones in between are
+// deltas against the record before them. Reading any generation decodes at most one keyframe
+// and keyframeInterval-1 deltas.
+struct HistoryHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	char type[32];
+	uint64_t popSize;
+	uint64_t genomeSize;
+	uint64_t motherOffset;
+	uint64_t motherSize;
+	uint8_t reserved[48];
+};
+static_assert(sizeof(HistoryHeader) == 128, "History header has to stay 128 bytes");
+
+struct HistoryEntry {
+	uint64_t generation;
+	uint64_t offset;   // payload in the .hist file
+	uint64_t size;
+	uint32_t keyframe; // entry the decoding starts from (itself for keyframes)
+	uint32_t isKeyframe;
+};
+static_assert(sizeof(HistoryEntry) == 32, "History entries have to stay 32 bytes");
+
+struct History {
+	static constexpr char magic[8] = {'G', 'B', 'D', 'H', 'I', 'S', 'T', '\0'};
+	static constexpr char indexMagic[8] = {'G', 'B', 'D', 'H', 'I', 'D', 'X', '\0'};
+	static constexpr uint32_t version = 1;
+	static constexpr uint64_t indexHeaderSize = 16;
+
+	static std::string historyPath(const std::string &path) {
+		return path + ".hist";
+	}
+
+	static std::string indexPath(const std::string &path) {
+		return path + ".idx";
+	}
+};
+
+// Read-only view of a history (the .hist is memory mapped, the small index read in full).
+struct CheckpointHistoryView {
+	CheckpointHistoryView(const std::string &path) {
+		const std::string histPath = History::historyPath(path);
+
+		fd = ::open(histPath.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("Cannot open checkpoint history: " + histPath);
+		}
+
+		struct stat st;
+		if (::fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(HistoryHeader)) {
+			::close(fd);
+			throw std::runtime_error("Checkpoint history too small: " + histPath);
+		}
+		size = st.st_size;
+
+		data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			::close(fd);
+			throw std::runtime_error("Cannot map checkpoint history: " + histPath);
+		}
+
+		const HistoryHeader &h = header();
+		if (std::memcmp(h.magic, History::magic, sizeof(History::magic)) != 0 ||
+			h.version != History::version || h.byteOrder != Checkpoint::byteOrderMark ||
+			h.motherOffset + h.motherSize > size) {
+			release();
+			throw std::runtime_error("Invalid or unsupported checkpoint history: " + histPath);
+		}
+
+		readIndex(History::indexPath(path));
+	}
+
+	~CheckpointHistoryView() {
+		release();
+	}
+
+	CheckpointHistoryView(const CheckpointHistoryView&) = delete;
+	CheckpointHistoryView& operator=(const CheckpointHistoryView&) = delete;
+
+	const HistoryHeader& header() const {
+		return *static_cast<const HistoryHeader*>(data);
+	}
+
+	std::string type() const {
+		return std::string(header().type, strnlen(header().type, sizeof(header().type)));
+	}
+
+	json motherDescription() const {
+		const char *text = bytes() + header().motherOffset;
+		return json::parse(text, text + header().motherSize);
+	}
+
+	// stored records (complete ones - a torn write at the end is ignored)
+	const std::vector<HistoryEntry>& entries() const {
+		return index;
+	}
+
+	bool contains(const uint64_t generation) const {
+		return find(generation) != index.size();
+	}
+
+	// weights of a stored generation, popSize * genomeSize floats (dense, no padding)
+	void population(const uint64_t generation, std::vector<float> &out) const {
+		const size_t e = find(generation);
+		if (e == index.size()) {
+			throw std::runtime_error("Generation " + std::to_string(generation) + " is not in the checkpoint history");
+		}
+		decode(e, out);
+	}
+
+	// the same as a snapshot (for the EAs / the checkpoint format)
+	EASnapshot snapshot(const uint64_t generation) const {
+		std::vector<float> dense;
+		population(generation, dense);
+
+		EASnapshot snap;
+		snap.type = type();
+		snap.generation = generation;
+		snap.motherDescription = motherDescription();
+		snap.setLayout(header().popSize, header().genomeSize);
+		for (size_t i = 0; i < snap.popSize; ++i) {
+			std::copy_n(&dense[i * snap.genomeSize], snap.genomeSize, snap.genome(i));
+		}
+
+		return snap;
+	}
+
+	// row of the previous stored generation every genome descends from (noRow - none, or a new run)
+	std::vector<uint32_t> lineage(const uint64_t generation) const {
+		const size_t e = find(generation);
+		if (e == index.size()) {
+			throw std::runtime_error("Generation " + std::to_string(generation) + " is not in the checkpoint history");
+		}
+		return HistoryCodec::decodeLineage(payload(index[e]), index[e].size, header().popSize);
+	}
+
+	// decodes the record at entry e
+	void decode(const size_t e, std::vector<float> &out) const {
+		const size_t N = header().popSize;
+		const size_t G = header().genomeSize;
+		const size_t w = HistoryCodec::indexBytes(N);
+
+		const HistoryEntry &key = index[index[e].keyframe];
+		out.resize(N * G);
+		std::memcpy(out.data(), payload(key) + N*w, N * G * sizeof(float));
+
+		std::vector<float> next(N * G);
+		for (size_t d = index[e].keyframe + 1; d <= e; ++d) {
+			HistoryCodec::decodeDelta(out.data(), payload(index[d]), index[d].size, N, G, next.data());
+			out.swap(next);
+		}
+	}
+
+private:
+	int fd = -1;
+	void *data = nullptr;
+	size_t size = 0;
+
+	std::vector<HistoryEntry> index;
+
+	const char* bytes() const {
+		return static_cast<const char*>(data);
+	}
+
+	const uint8_t* payload(const HistoryEntry &entry) const {
+		return reinterpret_cast<const uint8_t*>(bytes() + entry.offset);
+	}
+
+	size_t find(const uint64_t generation) const {
+		auto it = std::lower_bound(index.begin(), index.end(), generation,
+								   [](const HistoryEntry &e, uint64_t g){ return e.generation < g; });
+		return (it != index.end() && it->generation == generation) ? it - index.begin() : index.size();
+	}
+
+	void readIndex(const std::string &path) {
+		std::ifstream file(path, std::ios::binary);
+		char head[History::indexHeaderSize] = {};
+		file.read(head, sizeof(head));
+		if (file.gcount() != sizeof(head) || std::memcmp(head, History::indexMagic, sizeof(History::indexMagic)) != 0) {
+			release();
+			throw std::runtime_error("Invalid checkpoint history index: " + path);
+		}
+
+		const size_t N = header().popSize;
+		const size_t G = header().genomeSize;
+		const uint64_t records = header().motherOffset + header().motherSize;
+
+		HistoryEntry entry;
+		while (file.read(reinterpret_cast<char*>(&entry), sizeof(entry))) {
+			// a record past the end of the file or out of order - the writer died mid-append
+			const bool keyOk = entry.isKeyframe ? (entry.keyframe == index.size() && entry.size == N*HistoryCodec::indexBytes(N) + N*G*sizeof(float))
+												: (entry.keyframe < index.size() && !index.empty() && index.back().keyframe == entry.keyframe);
+			if (entry.offset < records || entry.offset + entry.size > size || !keyOk ||
+				(!index.empty() && entry.generation <= index.back().generation)) {
+				break;
+			}
+			index.push_back(entry);
+		}
+	}
+
+	void release() {
+		if (data && data != MAP_FAILED) ::munmap(data, size);
+		if (fd >= 0) ::close(fd);
+		data = nullptr;
+		fd = -1;
+	}
+};
+
+// Appends generations to a history. Not thread safe - the CheckpointWriter thread does the appends.
+// Opening an existing history continues it: a torn record at the end is cut off, and a resumed run
+// that went back in time (restored from an older checkpoint) drops the generations it will redo.
+struct CheckpointHistory {
+	const std::string path;
+	const size_t keyframeInterval;
+
+	CheckpointHistory(const std::string &path, const size_t keyframeInterval = 16)
+		: path(path), keyframeInterval(std::max<size_t>(1, keyframeInterval)) {}
+
+	~CheckpointHistory() {
+		if (histFd >= 0) ::close(histFd);
+		if (indexFd >= 0) ::close(indexFd);
+	}
+
+	CheckpointHistory(const CheckpointHistory&) = delete;
+	CheckpointHistory& operator=(const CheckpointHistory&) = delete;
+
+	// sync = fsync both files (the record before its index entry)
+	void append(const EASnapshot &snapshot, const bool sync = true) {
+		if (histFd < 0) open(snapshot);
+		assert(snapshot.popSize == popSize && snapshot.genomeSize == genomeSize && "History populations have to keep their layout");
+
+		if (!index.empty() && snapshot.generation <= index.back().generation) {
+			rewind(snapshot.generation);
+		}
+
+		next.resize(popSize * genomeSize);
+		for (size_t i = 0; i < popSize; ++i) {
+			std::copy_n(snapshot.genome(i), genomeSize, &next[i * genomeSize]);
+		}
+
+		const bool keyframe = index.empty() || (index.size() - index.back().keyframe) >= keyframeInterval;
+
+		HistoryCodec::encodeDelta(prev.empty() ? nullptr : prev.data(), next.data(), popSize, genomeSize, payload, lineage);
+		if (keyframe) {
+			// the lineage part is the same, the genes follow in full
+			payload.resize(popSize * HistoryCodec::indexBytes(popSize));
+			const uint8_t *weights = reinterpret_cast<const uint8_t*>(next.data());
+			payload.insert(payload.end(), weights, weights + next.size() * sizeof(float));
+		}
+
+		HistoryEntry entry{};
+		entry.generation = snapshot.generation;
+		entry.offset = end;
+		entry.size = payload.size();
+		entry.keyframe = keyframe ? index.size() : index.back().keyframe;
+		entry.isKeyframe = keyframe;
+
+		writeAll(histFd, payload.data(), payload.size(), end);
+		if (sync && ::fdatasync(histFd) != 0) throw std::runtime_error("fsync failed: " + History::historyPath(path));
+
+		writeAll(indexFd, &entry, sizeof(entry), History::indexHeaderSize + index.size() * sizeof(entry));
+		if (sync && ::fdatasync(indexFd) != 0) throw std::runtime_error("fsync failed: " + History::indexPath(path));
+
+		end += payload.size();
+		index.push_back(entry);
+		prev.swap(next);
+	}
+
+	size_t size() const {
+		return index.size();
+	}
+
+private:
+	int histFd = -1;
+	int indexFd = -1;
+	size_t popSize = 0;
+	size_t genomeSize = 0;
+	uint64_t recordsStart = 0; // behind the header + mother
+	uint64_t end = 0;
+
+	std::vector<HistoryEntry> index;
+	std::vector<float> prev;
+	std::vector<float> next;
+	std::vector<uint8_t> payload;
+	std::vector<uint32_t> lineage;
+
+	void open(const EASnapshot &snapshot) {
+		popSize = snapshot.popSize;
+		genomeSize = snapshot.genomeSize;
+
+		const std::string histPath = History::historyPath(path);
+		const std::string idxPath = History::indexPath(path);
+
+		if (std::filesystem::exists(histPath) && std::filesystem::exists(idxPath)) {
+			CheckpointHistoryView view(path);
+			if (view.type() != snapshot.type || view.header().popSize != popSize || view.header().genomeSize != genomeSize) {
+				throw std::runtime_error("Checkpoint history " + path + " belongs to a different EA");
+			}
+
+			index = view.entries();
+			recordsStart = view.header().motherOffset + view.header().motherSize;
+			end = index.empty() ? recordsStart : index.back().offset + index.back().size;
+			if (!index.empty()) view.decode(index.size() - 1, prev);
+
+			histFd = ::open(histPath.c_str(), O_WRONLY);
+			indexFd = ::open(idxPath.c_str(), O_WRONLY);
+			if (histFd < 0 || indexFd < 0) throw std::runtime_error("Cannot open checkpoint history: " + path);
+
+			truncate();
+			return;
+		}
+
+		histFd = ::open(histPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		indexFd = ::open(idxPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (histFd < 0 || indexFd < 0) throw std::runtime_error("Cannot create checkpoint history: " + path);
+
+		const std::string mother = snapshot.motherDescription.dump();
+
+		HistoryHeader header{};
+		std::memcpy(header.magic, History::magic, sizeof(History::magic));
+		header.version = History::version;
+		header.byteOrder = Checkpoint::byteOrderMark;
+		assert(snapshot.type.size() < sizeof(header.type) && "EA type name too long for the history header");
+		std::memcpy(header.type, snapshot.type.data(), snapshot.type.size());
+		header.popSize = popSize;
+		header.genomeSize = genomeSize;
+		header.motherOffset = sizeof(HistoryHeader);
+		header.motherSize = mother.size();
+
+		writeAll(histFd, &header, sizeof(header), 0);
+		writeAll(histFd, mother.data(), mother.size(), sizeof(header));
+		recordsStart = sizeof(header) + mother.size();
+		end = recordsStart;
+
+		char indexHeader[History::indexHeaderSize] = {};
+		std::memcpy(indexHeader, History::indexMagic, sizeof(History::indexMagic));
+		std::memcpy(indexHeader + sizeof(History::indexMagic), &History::version, sizeof(History::version));
+		writeAll(indexFd, indexHeader, sizeof(indexHeader), 0);
+	}
+
+	// forget the stored generations >= generation, deltas continue from the last one kept
+	void rewind(const uint64_t generation) {
+		while (!index.empty() && index.back().generation >= generation) {
+			index.pop_back();
+		}
+		end = index.empty() ? recordsStart : index.back().offset + index.back().size;
+		truncate();
+
+		prev.clear();
+		if (!index.empty()) {
+			// the kept records are on disk - decode the last one through a fresh view
+			CheckpointHistoryView view(path);
+			view.decode(index.size() - 1, prev);
+		}
+	}
+
+	void truncate() {
+		if (::ftruncate(histFd, end) != 0 || ::ftruncate(indexFd, History::indexHeaderSize + index.size() * sizeof(HistoryEntry)) != 0) {
+			throw std::runtime_error("Cannot truncate checkpoint history: " + path);
+		}
+	}
+
+	static void writeAll(const int fd, const void *bytes, size_t count, off_t offset) {
+		const char *p = static_cast<const char*>(bytes);
+		while (count > 0) {
+			const ssize_t written = ::pwrite(fd, p, count, offset);
+			if (written <= 0) throw std::runtime_error("Writing checkpoint history failed");
+			p += written;
+			offset += written;
+			count -= written;
+		}
+	}
+};
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "drone.hpp"
+#include "ea.hpp"
+#include "runner.hpp"
+#include "spsc_queue.hpp"
+#include "utils.hpp"
+
+enum class MigrationTopology {
+	Ring,              // i -> i+1
+	BidirectionalRing, // i -> i-1 and i+1
+	FullyConnected,    // i -> every other island
+};
+
+struct IslandConfig {
+	size_t islandCount = 4;
+	size_t migrationInterval = 20; // in generations
+	size_t migrantCount = 2;
+	size_t linkCapacity = 4;       // migrant batches buffered per link before they get dropped
+	MigrationTopology topology = MigrationTopology::Ring;
+};
+
+using MigrantBatch = std::vector<Weights>;
+
+// Runs N independent EAs (one per thread) which exchange their best individuals
+// through lock-free SPSC links. Islands never wait for each other.
+struct IslandRunner : public AbstractRunner {
+	IslandRunner(const IslandConfig &config, std::function<std::unique_ptr<AbstractEA>()> islandFactory)
+		: config(config), islandFactory(islandFactory) {
+		assert(config.islandCount > 0 && "Island model needs at least one island");
+		assert(config.migrationInterval > 0 && "Migration interval has to be at least one generation");
+	}
+
+	void prepare(const std::vector<World> &levels) override {
+		currentLevel = 0;
+		worldLevels = levels;
+	}
+
+	// the passed ea becomes island 0, the rest is created by the island factory
+	void run(Drone &drone, std::unique_ptr<AbstractEA> ea, const int maxGen, const std::string &note) override {
+		islands.clear();
+		links.clear();
+
+		for (int i = 0; i < config.islandCount; ++i) {
+			islands.push_back(std::make_unique<Island>());
+			islands[i]->ea = (i == 0) ? std::move(ea) : islandFactory();
+			islands[i]->ea->verbose = false;
+		}
+
+		connectIslands();
+
+		std::vector<std::thread> threads;
+		for (int i = 0; i < config.islandCount; ++i) {
+			threads.emplace_back(&IslandRunner::islandLoop, this, i, maxGen, note);
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		while (!allDone()) {
+			std::this_thread::sleep_for(std::chrono::seconds(1));
+			reportProcedure(start);
+		}
+
+		for (auto && t : threads) {
+			t.join();
+		}
+
+		reportProcedure(start);
+	}
+
+private:
+	struct Island {
+		std::unique_ptr<AbstractEA> ea;
+		int level = 0;
+
+		std::vector<SpscQueue<MigrantBatch>*> outgoing;
+		std::vector<SpscQueue<MigrantBatch>*> incoming;
+
+		// published for the reporting thread
+		std::atomic<uint64_t> generation{0};
+		std::atomic<float> lastBest{0};
+		std::atomic<bool> done{false};
+	};
+
+	const IslandConfig config;
+	std::function<std::unique_ptr<AbstractEA>()> islandFactory;
+
+	std::vector<std::unique_ptr<Island>> islands;
+	std::vector<std::unique_ptr<SpscQueue<MigrantBatch>>> links;
+
+	void link(size_t from, size_t to) {
+		links.push_back(std::make_unique<SpscQueue<MigrantBatch>>(config.linkCapacity));
+
+		islands[from]->outgoing.push_back(links.back().get());
+		islands[to]->incoming.push_back(links.back().get());
+	}
+
+	void connectIslands() {
+		const size_t N = islands.size();
+		if (N < 2) return;
+
+		for (size_t i = 0; i < N; ++i) {
+			switch (config.topology) {
+				case MigrationTopology::Ring:
+					link(i, (i + 1) % N);
+					break;
+				case MigrationTopology::BidirectionalRing:
+					link(i, (i + 1) % N);
+					// with 2 islands both neighbours are the same island
+					if (N > 2) link(i, (i + N - 1) % N);
+					break;
+				case MigrationTopology::FullyConnected:
+					for (size_t j = 0; j < N; ++j) {
+						if (j != i) link(i, j);
+					}
+					break;
+			}
+		}
+	}
+
+	void islandLoop(const size_t idx, const int maxGen, const std::string &note) {
+		Island &island = *islands[idx];
+		AbstractEA &ea = *island.ea;
+
+		while ((maxGen > 0) ? (ea.generation < maxGen) : true)
+		{
+			// EA LOGIC
+			if (!ea.update(dt, worldLevels[island.level], false)) continue;
+
+			ea.process();
+
+			levelUpProcedure(ea, island.level);
+
+			if (ea.generation % config.migrationInterval == 0) {
+				migrate(island);
+			}
+
+			if (ea.generation % 1000 == 0) {
+				saveProcedure(ea, note + "_island" + std::to_string(idx), island.level);
+			}
+
+			island.generation.store(ea.generation, std::memory_order_relaxed);
+			island.lastBest.store(ea.lastFitnessStats.max, std::memory_order_relaxed);
+		}
+
+		island.done.store(true, std::memory_order_release);
+	}
+
+	void migrate(Island &island) {
+		// a full link just drops the batch - the sender never waits on a slow neighbour
+		for (auto queue : island.outgoing) {
+			queue->push(island.ea->emigrants(config.migrantCount));
+		}
+
+		MigrantBatch arrived;
+		MigrantBatch batch;
+		for (auto queue : island.incoming) {
+			while (queue->pop(batch)) {
+				arrived.insert(arrived.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+			}
+		}
+
+		if (!arrived.empty()) {
+			island.ea->immigrate(arrived);
+		}
+	}
+
+	bool allDone() const {
+		for (auto && island : islands) {
+			if (!island->done.load(std::memory_order_acquire)) return false;
+		}
+		return true;
+	}
+
+	void reportProcedure(const std::chrono::steady_clock::time_point &start) const {
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		uint64_t totalGen = 0;
+		size_t bestIsland = 0;
+		float bestFitness = islands[0]->lastBest.load(std::memory_order_relaxed);
+
+		for (size_t i = 0; i < islands.size(); ++i) {
+			totalGen += islands[i]->generation.load(std::memory_order_relaxed);
+
+			const float f = islands[i]->lastBest.load(std::memory_order_relaxed);
+			if (f > bestFitness) {
+				bestFitness = f;
+				bestIsland = i;
+			}
+		}
+
+		printf("Islands: %zu Gens: %lu Gen/s: %.2f --- Best island: %zu BF: %.3f\n",
+			   islands.size(), totalGen, totalGen / elapsed, bestIsland, bestFitness);
+	}
+};
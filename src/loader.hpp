@@ -1,8 +1,11 @@
 #pragma once
 
+#include "checkpoint.hpp"
 #include "ea.hpp"
+#include "save_reader.hpp"
 #include "easyea.hpp"
 #include "cosyne.hpp"
+#include "steadystate.hpp"
 #include <memory>
 #include <string>
 
@@ -12,6 +15,31 @@ struct Loader{
 
 		std::cout << "LOADING FROM "<< path << std::endl;
 
+		if (Checkpoint::isCheckpoint(path)) {
+			return loadCheckpoint(path, father);
+		}
+
+		return loadJson(path, father);
+	}
+
+	// JSON save streamed into a snapshot (see SaveReader), saves it can't stream go through the DOM
+	static std::unique_ptr<AbstractEA> loadJson(const std::string &path, const Drone &father) {
+		EASnapshot snap;
+		if (!SaveReader::read(path, snap)) {
+			std::cout << "EA save " << path << " can't be streamed - loading it whole" << std::endl;
+			return loadJsonDom(path, father);
+		}
+
+		Net mother = Net::loadConfig(snap.motherDescription);
+		mother.initialize();
+
+		std::unique_ptr<AbstractEA> loaded = create(snap.type, snap.popSize, mother, father);
+		loaded->loadPopW(snap);
+
+		return loaded;
+	}
+
+	static std::unique_ptr<AbstractEA> loadJsonDom(const std::string &path, const Drone &father) {
         std::ifstream input(path);
         json config;
         input >> config;
@@ -23,6 +51,27 @@ struct Loader{
 		Net mother = Net::loadConfig(config["motherNet"]);
         mother.initialize();
 
+		std::unique_ptr<AbstractEA> loaded = create(type, popSize, mother, father);
+		loaded->loadPopW(config);
+
+        return loaded;
+	}
+
+	// binary checkpoint - weights come straight from the mapped file
+	static std::unique_ptr<AbstractEA> loadCheckpoint(const std::string &path, const Drone &father) {
+		CheckpointView checkpoint(path);
+
+		Net mother = Net::loadConfig(checkpoint.motherDescription());
+		mother.initialize();
+
+		std::unique_ptr<AbstractEA> loaded = create(checkpoint.type(), checkpoint.header().popSize, mother, father);
+		loaded->restore(checkpoint);
+
+		return loaded;
+	}
+
+private:
+	static std::unique_ptr<AbstractEA> create(const std::string &type, const size_t popSize, const Net &mother, const Drone &father) {
 		std::unique_ptr<AbstractEA> loaded;
 		if (type == "EasyEA") {
 			loaded = std::make_unique<EasyEA>(popSize, mother, father);
@@ -30,12 +79,13 @@ struct Loader{
 		else if (type == "CoSyNE") {
 			loaded = std::make_unique<CoSyNE>(popSize, mother, father);
 		}
+		else if (type == "SteadyStateEA") {
+			loaded = std::make_unique<SteadyStateEA>(popSize, mother, father);
+		}
 		else {
 			throw std::invalid_argument("Unknown EA load type encountered");
 		}
 
-		loaded->loadPopW(config);
-
-        return loaded;
+		return loaded;
 	}
 };
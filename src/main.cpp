@@ -1,7 +1,10 @@
+#include "bench.hpp"
+#include "codegen.hpp"
 #include "cosyne.hpp"
 #include "drone.hpp"
 #include "ea.hpp"
 #include "easyea.hpp"
+#include "island.hpp"
 #include "loader.hpp"
 #include "net.hpp"
 #include <cassert>
@@ -10,7 +13,11 @@
 #include <string>
 
 #include "runner.hpp"
+#include "steadystate.hpp"
+#include "sweep.hpp"
+#include "tuner.hpp"
 #include "utils.hpp"
+#include "video.hpp"
 
 int main(int argc, char *argv[]) {
 
@@ -28,12 +35,35 @@ int main(int argc, char *argv[]) {
 		std::string eaConfig = argv[2];
 
 		ea = Loader::loadEA(eaConfig, drone);
+	} else if (std::string(argv[1]) == "replay") {
+		// ./Drone replay <trajectory log> [generation] - plays recorded episodes, no EA needed
+		runner = std::make_unique<ReplayRunner>(argv[2], (argc > 3) ? std::stoul(argv[3]) : 0);
 	} else if (std::string(argv[1]) == "window") {
 		runner = std::make_unique<EAWindowRunner>();
 	} else if (std::string(argv[1]) == "console") {
-		runner = std::make_unique<ConsoleRunner>();
+		auto console = std::make_unique<ConsoleRunner>();
+		// ./Drone console <ea type> resume - continue from the newest checkpoint
+		console->autoResume = (argc > 3 && std::string(argv[3]) == "resume");
+		/* console->telemetry = true; */
+		/* console->historyInterval = 10; */
+		// stop on a budget or when the best fitness stalls, a final checkpoint + saves/summary_<note>.json are written
+		/* console->budget = RunBudget{.maxSeconds = 4 * 3600, .plateauWindow = 300, .plateauEpsilon = 100.0f}; */
+		runner = std::move(console);
+	} else if (std::string(argv[1]) == "island") {
+		// created below, the island factory needs the mother net
+	} else if (std::string(argv[1]) == "sweep" || std::string(argv[1]) == "tune") {
+		// created below, the runs need the mother net
+	} else if (std::string(argv[1]) == "bench") {
+		// dispatched below, benchmarks need the mother net and the levels
+	} else if (std::string(argv[1]) == "render") {
+		// dispatched below, simulated episodes need the levels
+	} else if (std::string(argv[1]) == "export") {
+		// ./Drone export <save> [out header] [individual] - standalone inference kernel of a controller
+		const std::string header = (argc > 3) ? argv[3] : "controller.hpp";
+		const size_t individual = (argc > 4) ? std::stoul(argv[4]) : 0;
+		return Codegen::exportController(argv[2], drone, header, individual) ? 0 : 1;
 	} else {
-		std::cout << "Incorrect runner selected - possible: 'window', 'console', 'human'" << std::endl;
+		std::cout << "Incorrect runner selected - possible: 'window', 'console', 'island', 'human', 'replay', 'sweep', 'tune', 'bench', 'render', 'export'" << std::endl;
 		return 1;
 	}
 
@@ -44,20 +74,74 @@ int main(int argc, char *argv[]) {
 	mother.modules.push_back(std::make_unique<Tanh>(4));
 	mother.initialize();
 
-	if (std::string(argv[1]) != "human") {
-		assert(argc == 3 && "For window/console run please include ea type - 'easyea', 'cosyne'");
+	if (std::string(argv[1]) != "human" && std::string(argv[1]) != "bench" && std::string(argv[1]) != "replay" && std::string(argv[1]) != "render" && std::string(argv[1]) != "sweep" && std::string(argv[1]) != "tune") {
+		assert(argc >= 3 && "For window/console run please include ea type - 'easyea', 'cosyne', 'steady'");
 
 		if (std::string(argv[2]) == "easyea") {
 			ea = std::make_unique<EasyEA>(128, mother, drone);
 		} else if (std::string(argv[2]) == "cosyne") {
 			ea = std::make_unique<CoSyNE>(256, mother, drone);
+		} else if (std::string(argv[2]) == "steady") {
+			ea = std::make_unique<SteadyStateEA>(256, mother, drone);
 		} else {
-			std::cout << "Incorrect ea selected - possible: 'easyea', 'cosyne'"
+			std::cout << "Incorrect ea selected - possible: 'easyea', 'cosyne', 'steady'"
 					  << std::endl;
 			return 1;
 		}
 	}
 
+	// novelty search (helps on world_lvl2 where the walls block the direct path)
+	/* ea->enableNovelty(NoveltyConfig{.descriptor = BehaviourDescriptor::FinalPosition, .noveltyWeight = 0.5f}); */
+	// kill drones that can no longer make the selection cutoff (Exact keeps selection unchanged, EasyEA only)
+	/* ea->racing = RacingMode::Exact; */
+	// don't re-simulate unchanged elites/parents on static levels
+	/* ea->enableFitnessCache(); */
+	// simulate only the best predicted half of each generation, the rest gets an imputed fitness
+	/* ea->enableSurrogate(SurrogateConfig{.simulateFraction = 0.5f}); */
+	// select on Pareto ranks of goals, time to goal and energy instead of the scalar fitness
+	/* ea->enableMultiObjective(MultiObjectiveConfig{}); */
+	// saves are binary checkpoints, this also writes the old JSON next to them
+	/* ea->exportJson = true; */
+	// query the controller only every k ticks, thrust is held in between (see ./Drone bench control)
+	/* ea->controlPeriod = 2; */
+	// binary log of the best 4 episodes of every generation (generational EAs)
+	/* ea->enableTrajectories("trajectories/run.traj", TrajectoryConfig{.bestCount = 4}); */
+
+	if (std::string(argv[1]) == "island") {
+		const std::string eaType = argv[2];
+		runner = std::make_unique<IslandRunner>(IslandConfig{}, [&mother, &drone, eaType]() -> std::unique_ptr<AbstractEA> {
+			if (eaType == "easyea") {
+				return std::make_unique<EasyEA>(128, mother, drone);
+			}
+			if (eaType == "steady") {
+				return std::make_unique<SteadyStateEA>(256, mother, drone, 1);
+			}
+			return std::make_unique<CoSyNE>(256, mother, drone);
+		});
+	}
+
+	if (std::string(argv[1]) == "sweep") {
+		// ./Drone sweep [grid.json] [generations] [runs] [out dir] - every grid point x runs on one thread pool,
+		// the grid file replaces the SweepGrid defaults (see SweepGrid::load), the arguments after it override it
+		int arg = 2;
+		SweepGrid grid = (argc > arg && std::string(argv[arg]).ends_with(".json")) ? SweepGrid::load(argv[arg++]) : SweepGrid{};
+		if (argc > arg) grid.generations = std::stoi(argv[arg]);
+		if (argc > arg + 1) grid.runs = std::stoul(argv[arg + 1]);
+		if (argc > arg + 2) grid.outDir = argv[arg + 2];
+
+		runner = std::make_unique<SweepRunner>(grid, mother);
+	}
+
+	if (std::string(argv[1]) == "tune") {
+		// ./Drone tune [max generations] [out dir] - Hyperband over TunerSpace, bad configurations stop early
+		TunerConfig config{};
+		/* config.hyperband = false; */
+		if (argc > 2) config.maxGenerations = std::stoi(argv[2]);
+		if (argc > 3) config.outDir = argv[3];
+
+		runner = std::make_unique<TunerRunner>(config, TunerSpace{}, mother);
+	}
+
 	const World world{
 		.boundary = sf::Vector2f{winWidth, winHeight},
 	    .walls = {},
@@ -96,6 +180,45 @@ int main(int argc, char *argv[]) {
 		false,
 	};
 
+	if (std::string(argv[1]) == "render") {
+		// ./Drone render <save | log.traj> [out dir] [png|raw] [individual | generation] - headless frame export
+		const std::string outDir = (argc > 3) ? argv[3] : "frames";
+		const FrameFormat format = (argc > 4 && std::string(argv[4]) == "raw") ? FrameFormat::Raw : FrameFormat::Png;
+		const long select = (argc > 5) ? std::stol(argv[5]) : -1;
+		return Video::exportFrames(argv[2], outDir, format, select, world, drone) ? 0 : 1;
+	}
+
+	if (std::string(argv[1]) == "bench") {
+		const std::vector<World> levels{world, world_randomized, world_lvl2, world_lvl2_randomized};
+
+		if (std::string(argv[2]) == "control") {
+			Bench::controlPeriod(mother, drone, levels, (argc > 3) ? std::stoi(argv[3]) : 100);
+		} else if (std::string(argv[2]) == "reward") {
+			return Bench::reward() ? 0 : 1;
+		} else if (std::string(argv[2]) == "nds") {
+			return Bench::nds(mother, drone, world) ? 0 : 1;
+		} else if (std::string(argv[2]) == "checkpoint") {
+			return Bench::checkpoint(mother, drone) ? 0 : 1;
+		} else if (std::string(argv[2]) == "async") {
+			Bench::asyncSave(mother, drone);
+		} else if (std::string(argv[2]) == "history") {
+			return Bench::history(mother, drone, world, (argc > 3) ? std::stoi(argv[3]) : 64) ? 0 : 1;
+		} else if (std::string(argv[2]) == "json") {
+			return Bench::jsonLoad(mother, drone, (argc > 3) ? std::stoul(argv[3]) : 10000) ? 0 : 1;
+		} else if (std::string(argv[2]) == "trajectory") {
+			return Bench::trajectory(mother, drone, world, (argc > 3) ? std::stoi(argv[3]) : 50) ? 0 : 1;
+		} else if (std::string(argv[2]) == "window") {
+			return Bench::windowed(mother, drone, world, (argc > 3) ? std::stoi(argv[3]) : 100) ? 0 : 1;
+		} else if (std::string(argv[2]) == "population") {
+			return Bench::population((argc > 3) ? std::stoul(argv[3]) : 10000) ? 0 : 1;
+		} else {
+			std::cout << "Incorrect benchmark selected - possible: 'control', 'reward', 'nds', 'checkpoint', 'async', 'history', 'json', 'trajectory', 'window', 'population'" << std::endl;
+			return 1;
+		}
+
+		return 0;
+	}
+
 	runner->prepare(std::vector<World>{world, world_randomized, world_lvl2, world_lvl2_randomized});
 	/* runner->prepare(std::vector<World>{world, world_lvl2}); */
 	runner->run(drone, std::move(ea), -1);
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "BS_thread_pool.hpp"
+#include "drone.hpp"
+#include "net.hpp"
+#include "utils.hpp"
+
+// Static KD-tree over a flat array of points (dims floats per point).
+// Implicit layout - the median of every range is its node, small ranges are leaf buckets.
+struct KDTree {
+	static constexpr size_t leafSize = 8;
+
+	void build(const float *points, size_t count, size_t dims) {
+		this->dims = dims;
+		this->count = count;
+
+		ids.resize(count);
+		std::iota(ids.begin(), ids.end(), 0);
+		splitDim.assign(count, 0);
+
+		buildRange(points, 0, count);
+
+		// store the points in tree order so that searches walk contiguous memory
+		pts.resize(count * dims);
+		for (size_t i = 0; i < count; ++i) {
+			std::copy(points + ids[i]*dims, points + (ids[i]+1)*dims, pts.begin() + i*dims);
+		}
+	}
+
+	size_t size() const { return count; }
+
+	// squared distances of the k nearest points to the query, ascending
+	// (the point with the original index 'exclude' is skipped)
+	void knn(const float *query, size_t k, size_t exclude, std::vector<float> &out) const {
+		std::priority_queue<float> best; // max-heap of the k best squared distances
+
+		if (count > 0 && k > 0) {
+			search(query, k, exclude, 0, count, best);
+		}
+
+		out.resize(best.size());
+		for (size_t i = best.size(); i > 0; --i) {
+			out[i-1] = best.top();
+			best.pop();
+		}
+	}
+
+	// mean euclidean distance to the k nearest points for every query
+	// query q skips the point excludeBase + q (pass npos to keep all points)
+	void meanKnnDistanceBatch(const float *queries, size_t queryCount, size_t k, size_t excludeBase,
+							  std::vector<float> &out, BS::thread_pool<> &pool) const {
+		out.resize(queryCount);
+
+		// waits only for its own blocks - the pool may be busy with another EA's queries
+		pool.submit_blocks(size_t(0), queryCount, [&](const size_t start, const size_t end) {
+			std::vector<float> dists;
+			dists.reserve(k);
+
+			for (size_t q = start; q < end; ++q) {
+				const size_t exclude = (excludeBase == npos) ? npos : excludeBase + q;
+				knn(queries + q*dims, k, exclude, dists);
+
+				float sum = 0;
+				for (float d : dists) {
+					sum += std::sqrt(d);
+				}
+				out[q] = dists.empty() ? 0.0f : sum / dists.size();
+			}
+		}).wait();
+	}
+
+	static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+private:
+	size_t dims = 0;
+	size_t count = 0;
+
+	std::vector<float> pts;       // points in tree order
+	std::vector<size_t> ids;      // tree position -> original index
+	std::vector<uint8_t> splitDim;
+
+	void buildRange(const float *points, size_t lo, size_t hi) {
+		if (hi - lo <= leafSize) return;
+
+		// split along the widest dimension of the range
+		size_t bestDim = 0;
+		float bestSpread = -1;
+		for (size_t d = 0; d < dims; ++d) {
+			float mn = std::numeric_limits<float>::max();
+			float mx = std::numeric_limits<float>::lowest();
+			for (size_t i = lo; i < hi; ++i) {
+				const float v = points[ids[i]*dims + d];
+				mn = std::min(mn, v);
+				mx = std::max(mx, v);
+			}
+			if (mx - mn > bestSpread) {
+				bestSpread = mx - mn;
+				bestDim = d;
+			}
+		}
+
+		const size_t mid = lo + (hi - lo) / 2;
+		std::nth_element(ids.begin() + lo, ids.begin() + mid, ids.begin() + hi, [&](size_t a, size_t b) {
+			return points[a*dims + bestDim] < points[b*dims + bestDim];
+		});
+		splitDim[mid] = bestDim;
+
+		buildRange(points, lo, mid);
+		buildRange(points, mid + 1, hi);
+	}
+
+	void consider(const float *query, size_t k, size_t exclude, size_t i, std::priority_queue<float> &best) const {
+		if (ids[i] == exclude) return;
+
+		float d2 = 0;
+		for (size_t d = 0; d < dims; ++d) {
+			const float diff = query[d] - pts[i*dims + d];
+			d2 += diff*diff;
+		}
+
+		if (best.size() < k) {
+			best.push(d2);
+		}
+		else if (d2 < best.top()) {
+			best.pop();
+			best.push(d2);
+		}
+	}
+
+	void search(const float *query, size_t k, size_t exclude, size_t lo, size_t hi, std::priority_queue<float> &best) const {
+		if (hi - lo <= leafSize) {
+			for (size_t i = lo; i < hi; ++i) {
+				consider(query, k, exclude, i, best);
+			}
+			return;
+		}
+
+		const size_t mid = lo + (hi - lo) / 2;
+		const size_t d = splitDim[mid];
+		const float diff = query[d] - pts[mid*dims + d];
+
+		consider(query, k, exclude, mid, best);
+
+		// nearer side first, the far side only if the splitting plane is within reach
+		if (diff < 0) {
+			search(query, k, exclude, lo, mid, best);
+			if (best.size() < k || diff*diff < best.top()) search(query, k, exclude, mid + 1, hi, best);
+		}
+		else {
+			search(query, k, exclude, mid + 1, hi, best);
+			if (best.size() < k || diff*diff < best.top()) search(query, k, exclude, lo, mid, best);
+		}
+	}
+};
+
+enum class BehaviourDescriptor {
+	FinalPosition, // where the drone ended (normalized to the window)
+	GoalVisits,    // when the drone collected each of its first goals
+};
+
+struct NoveltyConfig {
+	BehaviourDescriptor descriptor = BehaviourDescriptor::FinalPosition;
+	size_t k = 15;
+	float noveltyWeight = 0.5f;  // 0 = pure fitness, 1 = pure novelty search
+	size_t archivePerGen = 4;    // most novel individuals of a generation that enter the archive
+	size_t goalVisitSlots = 5;   // descriptor length for GoalVisits
+};
+
+// one pool of k-NN workers for the whole process - islands each with their own novelty search
+// would otherwise start a pool of every core per island, on top of the island threads
+inline BS::thread_pool<> &noveltyPool() {
+	static BS::thread_pool<> pool(std::max(1u, std::thread::hardware_concurrency()));
+	return pool;
+}
+
+// k-NN novelty against a growing archive of past behaviours (+ the current population).
+struct NoveltySearch {
+	const NoveltyConfig config;
+
+	NoveltySearch(const NoveltyConfig &config) : config(config), pool(noveltyPool()) {}
+
+	size_t dims() const {
+		return (config.descriptor == BehaviourDescriptor::FinalPosition) ? 2 : config.goalVisitSlots;
+	}
+
+	size_t archiveSize() const {
+		return archive.size() / dims();
+	}
+
+	const std::vector<float>& lastNovelty() const {
+		return novelty;
+	}
+
+	// the archive goes to a checkpoint as a raw float block
+	const std::vector<float>& archiveData() const {
+		return archive;
+	}
+
+	void loadArchive(const float *data, const size_t size) {
+		if (size % dims() != 0) {
+			throw std::runtime_error("Checkpoint novelty archive does not match the behaviour descriptor");
+		}
+		archive.assign(data, data + size);
+	}
+
+	void describe(const Drone &drone, float *out) const {
+		switch (config.descriptor) {
+			case BehaviourDescriptor::FinalPosition:
+				out[0] = drone.pos.x / winWidth;
+				out[1] = drone.pos.y / winHeight;
+				break;
+			case BehaviourDescriptor::GoalVisits:
+				// tick of the visit in episode lengths, goals never reached count as "very late"
+				for (size_t g = 0; g < config.goalVisitSlots; ++g) {
+					out[g] = (g < drone.goalVisits.size()) ? drone.goalVisits[g] / 600.0f : 2.0f;
+				}
+				break;
+		}
+	}
+
+	// replaces the (final) fitness with the fitness/novelty blend used for selection
+	void apply(const std::vector<std::unique_ptr<Drone>> &agents, std::vector<float> &fitness) {
+		const size_t D = dims();
+		const size_t N = fitness.size();
+
+		population.resize(N * D);
+		for (size_t i = 0; i < N; ++i) {
+			describe(*agents[i], &population[i*D]);
+		}
+
+		// the population is its own neighbourhood too - archive first, population behind it
+		points.assign(archive.begin(), archive.end());
+		points.insert(points.end(), population.begin(), population.end());
+		tree.build(points.data(), points.size() / D, D);
+
+		tree.meanKnnDistanceBatch(population.data(), N, config.k, archiveSize(), novelty, pool);
+
+		blend(fitness);
+		growArchive();
+	}
+
+private:
+	std::vector<float> archive;
+	std::vector<float> population;
+	std::vector<float> points;
+	std::vector<float> novelty;
+
+	KDTree tree;
+	BS::thread_pool<> &pool;
+
+	void blend(std::vector<float> &fitness) const {
+		const auto [fMin, fMax] = std::minmax_element(fitness.begin(), fitness.end());
+		const auto [nMin, nMax] = std::minmax_element(novelty.begin(), novelty.end());
+
+		const float fLow = *fMin, fRange = std::max(*fMax - *fMin, 1e-6f);
+		const float nLow = *nMin, nRange = std::max(*nMax - *nMin, 1e-6f);
+
+		const float w = config.noveltyWeight;
+		for (size_t i = 0; i < fitness.size(); ++i) {
+			fitness[i] = (1.0f - w) * (fitness[i] - fLow) / fRange + w * (novelty[i] - nLow) / nRange;
+		}
+	}
+
+	void growArchive() {
+		const size_t D = dims();
+		const size_t n = std::min(config.archivePerGen, novelty.size());
+
+		std::vector<size_t> idx(novelty.size());
+		std::iota(idx.begin(), idx.end(), 0);
+		std::partial_sort(idx.begin(), idx.begin() + n, idx.end(), [&](size_t a, size_t b){return novelty[a] > novelty[b];});
+
+		for (size_t i = 0; i < n; ++i) {
+			archive.insert(archive.end(), population.begin() + idx[i]*D, population.begin() + (idx[i]+1)*D);
+		}
+	}
+};
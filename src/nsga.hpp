@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "drone.hpp"
+
+// Pareto ranking over a flat objective matrix (n rows of m objectives, all minimized).
+struct ParetoSort {
+	// a dominates b - no worse in every objective, better in at least one
+	static bool dominates(const float *a, const float *b, const size_t m) {
+		bool better = false;
+		for (size_t k = 0; k < m; ++k) {
+			if (a[k] > b[k]) return false;
+			if (a[k] < b[k]) better = true;
+		}
+		return better;
+	}
+
+	// Efficient non-dominated sort with binary search (ENS-BS).
+	// Points are visited in lexicographic order, so no later point can dominate an earlier one,
+	// and every point goes to the first front with no dominator (found by binary search).
+	// With 2 objectives only the last member of a front needs checking - O(N log N),
+	// with more objectives a front is scanned from its newest member.
+	// Fills front[i] (0 = non-dominated), returns the number of fronts.
+	static size_t rank(const float *obj, const size_t n, const size_t m, std::vector<uint32_t> &front) {
+		front.resize(n);
+		if (n == 0) return 0;
+
+		std::vector<uint32_t> order(n);
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			return std::lexicographical_compare(obj + a*m, obj + (a+1)*m, obj + b*m, obj + (b+1)*m);
+		});
+
+		std::vector<std::vector<uint32_t>> fronts;
+
+		auto dominatedIn = [&](const std::vector<uint32_t> &members, const uint32_t p) {
+			if (m == 2) return dominates(obj + members.back()*m, obj + p*m, m);
+
+			for (size_t j = members.size(); j > 0; --j) {
+				if (dominates(obj + members[j-1]*m, obj + p*m, m)) return true;
+			}
+			return false;
+		};
+
+		for (const uint32_t p : order) {
+			size_t lo = 0, hi = fronts.size();
+			while (lo < hi) {
+				const size_t mid = lo + (hi - lo) / 2;
+				if (dominatedIn(fronts[mid], p)) lo = mid + 1;
+				else hi = mid;
+			}
+
+			if (lo == fronts.size()) fronts.emplace_back();
+			fronts[lo].push_back(p);
+			front[p] = lo;
+		}
+
+		return fronts.size();
+	}
+
+	// O(M N^2) reference (for the bench)
+	static size_t rankNaive(const float *obj, const size_t n, const size_t m, std::vector<uint32_t> &front) {
+		front.assign(n, 0);
+
+		std::vector<uint32_t> dominatedBy(n, 0);
+		std::vector<std::vector<uint32_t>> dominated(n);
+		for (size_t a = 0; a < n; ++a) {
+			for (size_t b = 0; b < n; ++b) {
+				if (dominates(obj + a*m, obj + b*m, m)) {
+					dominated[a].push_back(b);
+					dominatedBy[b] += 1;
+				}
+			}
+		}
+
+		std::vector<uint32_t> current;
+		for (size_t a = 0; a < n; ++a) {
+			if (dominatedBy[a] == 0) current.push_back(a);
+		}
+
+		size_t fronts = 0;
+		while (!current.empty()) {
+			std::vector<uint32_t> next;
+			for (const uint32_t a : current) {
+				front[a] = fronts;
+				for (const uint32_t b : dominated[a]) {
+					if (--dominatedBy[b] == 0) next.push_back(b);
+				}
+			}
+			current.swap(next);
+			fronts += 1;
+		}
+
+		return fronts;
+	}
+
+	// NSGA-II crowding distance inside every front, boundary points get infinity
+	static void crowding(const float *obj, const size_t n, const size_t m, const std::vector<uint32_t> &front,
+						 const size_t frontCount, std::vector<float> &distance) {
+		distance.assign(n, 0.0f);
+
+		std::vector<std::vector<uint32_t>> members(frontCount);
+		for (size_t i = 0; i < n; ++i) {
+			members[front[i]].push_back(i);
+		}
+
+		for (auto && f : members) {
+			for (size_t k = 0; k < m; ++k) {
+				std::sort(f.begin(), f.end(), [&](uint32_t a, uint32_t b){return obj[a*m + k] < obj[b*m + k];});
+
+				const float low = obj[f.front()*m + k];
+				const float range = obj[f.back()*m + k] - low;
+
+				distance[f.front()] = std::numeric_limits<float>::infinity();
+				distance[f.back()] = std::numeric_limits<float>::infinity();
+				if (range <= 0) continue;
+
+				for (size_t j = 1; j + 1 < f.size(); ++j) {
+					distance[f[j]] += (obj[f[j+1]*m + k] - obj[f[j-1]*m + k]) / range;
+				}
+			}
+		}
+	}
+};
+
+struct MultiObjectiveConfig {
+	bool timeToGoal = true; // ticks per collected goal
+	bool energy = true;     // thruster energy per collected goal
+};
+
+struct MultiObjectiveStats {
+	size_t fronts = 0;
+	size_t paretoSize = 0; // individuals in the first front
+};
+
+// NSGA-II style selection score. Objectives of every drone go into a matrix,
+// which gets ranked into Pareto fronts + crowding distance, and the resulting
+// order (front ascending, crowding descending) replaces the scalar fitness.
+// The EAs then select by it as before.
+struct MultiObjective {
+	const MultiObjectiveConfig config;
+
+	MultiObjective(const MultiObjectiveConfig &config) : config(config) {}
+
+	size_t objectiveCount() const {
+		return 1 + config.timeToGoal + config.energy;
+	}
+
+	// last generation's objective matrix (minimized - the fitness is negated)
+	const std::vector<float>& lastObjectives() const {
+		return objectives;
+	}
+
+	// goals collected come in through the final fitness - the goal bonus dominates it
+	// and the shaping reward breaks ties between equal goal counts (a gradient early on).
+	// Without a goal the per-goal costs are undefined and count as the worst possible,
+	// otherwise dying right away would be a free spot on the front for the energy objective.
+	void describe(const Drone &drone, const float fitness, float *out) const {
+		const float goals = drone.goalIndex;
+		const float worst = std::numeric_limits<float>::max();
+
+		size_t k = 0;
+		out[k++] = -fitness;
+		if (config.timeToGoal) out[k++] = (goals > 0) ? drone.goalVisits.back() / goals : worst;
+		if (config.energy)     out[k++] = (goals > 0) ? drone.energy / goals : worst;
+	}
+
+	// excluded individuals (never simulated) get the worst possible objectives
+	void apply(const std::vector<std::unique_ptr<Drone>> &agents, const std::vector<uint8_t> &excluded, std::vector<float> &fitness) {
+		const size_t M = objectiveCount();
+		const size_t N = fitness.size();
+
+		objectives.resize(N * M);
+		for (size_t i = 0; i < N; ++i) {
+			if (!excluded.empty() && excluded[i]) {
+				std::fill_n(&objectives[i*M], M, std::numeric_limits<float>::max());
+				continue;
+			}
+			describe(*agents[i], fitness[i], &objectives[i*M]);
+		}
+
+		const size_t fronts = ParetoSort::rank(objectives.data(), N, M, front);
+		ParetoSort::crowding(objectives.data(), N, M, front, fronts, distance);
+
+		order.resize(N);
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			if (front[a] != front[b]) return front[a] < front[b];
+			return distance[a] > distance[b];
+		});
+
+		for (size_t p = 0; p < N; ++p) {
+			fitness[order[p]] = N - p;
+		}
+
+		stats.fronts = fronts;
+		stats.paretoSize = std::count(front.begin(), front.end(), 0u);
+	}
+
+	const MultiObjectiveStats& lastStats() const {
+		return stats;
+	}
+
+private:
+	std::vector<float> objectives;
+	std::vector<uint32_t> front;
+	std::vector<float> distance;
+	std::vector<uint32_t> order;
+
+	MultiObjectiveStats stats;
+};
@@ -4,8 +4,11 @@
 #include <SFML/Graphics/CircleShape.hpp>
 #include <SFML/Graphics/Color.hpp>
 #include <SFML/Graphics/RectangleShape.hpp>
-#include <SFML/Graphics/RenderWindow.hpp>
+#include <SFML/Graphics/RenderTarget.hpp>
+#include <SFML/Graphics/VertexArray.hpp>
 #include <SFML/System/Vector2.hpp>
+#include <cmath>
+#include <memory>
 #include <vector>
 
 #include "drone.hpp"
@@ -56,7 +59,7 @@ public:
     }
 
 	void draw_body(const Drone *drone,
-				   sf::RenderWindow *target) {
+				   sf::RenderTarget *target) {
 		base.setPosition(drone->pos);
         center.setPosition(drone->pos);
 
@@ -114,7 +117,7 @@ public:
 	void draw_debug(const Drone *drone, 
                     const World &world, 
                     const std::vector<std::unique_ptr<Drone>> &drones,
-                    sf::RenderWindow *target) {
+                    sf::RenderTarget *target) {
 
         collisionSphere.setRadius(drone->contactRadius);
         collisionSphere.setOrigin(collisionSphere.getRadius(), collisionSphere.getRadius());
@@ -154,3 +157,127 @@ public:
         }
     }
 };
+
+// Whole populations at once - the shapes of Renderer::draw_body (and the sensor rays of
+// draw_debug) written as triangles into one vertex array, a frame is a single draw call
+// instead of six per drone.
+//
+//   begin() -> add(drone) / addSensors(drone, world) / addGoals(world) ... -> draw(target)
+class PopulationRenderer {
+    static constexpr int circleSegments = 12;
+
+    const sf::Color cBody = sf::Color(150,150,150);
+    const sf::Color cCenter = sf::Color::Green;
+    const sf::Color cCenterCollect = sf::Color(0,255,255);
+    const sf::Color cThrusterLeft = sf::Color::Red;
+    const sf::Color cThrusterRight = sf::Color::Blue;
+    const sf::Color cThrusterOn = sf::Color::Magenta;
+    const sf::Color cThrusterOff = sf::Color::White;
+    const sf::Color cGoal = sf::Color(240,190,4);
+
+    sf::VertexArray vertices{sf::Triangles};
+
+    // unit circle, the drone centers and goals are fans of it
+    sf::Vector2f circle[circleSegments + 1];
+
+public:
+    PopulationRenderer() {
+        for (int i = 0; i <= circleSegments; ++i) {
+            const float a = 2 * M_PI * i / circleSegments;
+            circle[i] = sf::Vector2f{std::cos(a), std::sin(a)};
+        }
+    }
+
+    // the array keeps its memory between frames
+    void begin() {
+        vertices.clear();
+    }
+
+    // same shapes, sizes and colors as Renderer::draw_body
+    void add(const Drone &drone) {
+        const float c = std::cos(drone.angle);
+        const float s = std::sin(drone.angle);
+        const sf::Vector2f rotatedOffset{
+            drone.thrusterOffset.x * c - drone.thrusterOffset.y * s,
+            drone.thrusterOffset.x * s + drone.thrusterOffset.y * c,
+        };
+
+        rect(drone.pos, c, s, -50, -10, 50, 10, cBody);
+        fan(drone.pos, 20, (drone.goalTimer > 0) ? cCenterCollect : cCenter);
+
+        const float lc = std::cos(drone.angle + drone.thrusterLeft.angle);
+        const float ls = std::sin(drone.angle + drone.thrusterLeft.angle);
+        const float rc = std::cos(drone.angle + drone.thrusterRight.angle);
+        const float rs = std::sin(drone.angle + drone.thrusterRight.angle);
+
+        rect(drone.pos - rotatedOffset, lc, ls, -7.5f, -20, 7.5f, 20, cThrusterLeft);
+        rect(drone.pos + rotatedOffset, rc, rs, -7.5f, -20, 7.5f, 20, cThrusterRight);
+
+        // exhausts - origin (7.5, -10) of the 15x5 rectangles
+        rect(drone.pos - rotatedOffset, lc, ls, -7.5f, 10, 7.5f, 15, (drone.thrusterLeft.powerController > 0) ? cThrusterOn : cThrusterOff);
+        rect(drone.pos + rotatedOffset, rc, rs, -7.5f, 10, 7.5f, 15, (drone.thrusterRight.powerController > 0) ? cThrusterOn : cThrusterOff);
+    }
+
+    // rays of Renderer::draw_debug - the whole length white, up to the hit red (casts the rays)
+    void addSensors(const Drone &drone, const World &world) {
+        for (auto && sensor : drone.sensors) {
+            const sf::Vector2f dir = sensor.getDir(&drone);
+            const sf::Vector2f start = drone.pos + dir*drone.contactRadius;
+
+            segment(start, drone.pos + dir*(drone.contactRadius + sensor.length), sf::Color::White);
+
+            const float check = sensor.check(&drone, world, {});
+            if (check < 1.0) {
+                segment(start, drone.pos + dir*(drone.contactRadius + check*sensor.length), sf::Color::Red);
+            }
+        }
+    }
+
+    void addGoals(const World &world) {
+        for (auto && g : world.goals) {
+            fan(g, 10, cGoal);
+        }
+    }
+
+    // the one draw call of the frame
+    void draw(sf::RenderTarget *target) const {
+        target->draw(vertices);
+    }
+
+    size_t vertexCount() const {
+        return vertices.getVertexCount();
+    }
+
+private:
+    // local box (x0, y0) - (x1, y1) rotated by (c, s) around pos
+    void rect(const sf::Vector2f &pos, const float c, const float s,
+              const float x0, const float y0, const float x1, const float y1, const sf::Color &color) {
+        auto at = [&](const float x, const float y) {
+            return sf::Vertex(sf::Vector2f{pos.x + x*c - y*s, pos.y + x*s + y*c}, color);
+        };
+
+        const sf::Vertex a = at(x0, y0), b = at(x1, y0), d = at(x1, y1), e = at(x0, y1);
+        vertices.append(a); vertices.append(b); vertices.append(d);
+        vertices.append(a); vertices.append(d); vertices.append(e);
+    }
+
+    void fan(const sf::Vector2f &pos, const float radius, const sf::Color &color) {
+        for (int i = 0; i < circleSegments; ++i) {
+            vertices.append(sf::Vertex(pos, color));
+            vertices.append(sf::Vertex(pos + circle[i]*radius, color));
+            vertices.append(sf::Vertex(pos + circle[i + 1]*radius, color));
+        }
+    }
+
+    // 2 px wide line
+    void segment(const sf::Vector2f &from, const sf::Vector2f &to, const sf::Color &color) {
+        const sf::Vector2f d = to - from;
+        const float length = std::sqrt(d.x*d.x + d.y*d.y);
+        if (length == 0) return;
+
+        const sf::Vector2f n{-d.y / length, d.x / length};
+        const sf::Vertex a(from - n, color), b(from + n, color), c(to + n, color), e(to - n, color);
+        vertices.append(a); vertices.append(b); vertices.append(c);
+        vertices.append(a); vertices.append(c); vertices.append(e);
+    }
+};
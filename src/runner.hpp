@@ -6,15 +6,21 @@
 #include <SFML/System/Vector2.hpp>
 #include <SFML/Window/ContextSettings.hpp>
 #include <SFML/Window/Mouse.hpp>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <fstream>
+#include <limits>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "drone.hpp"
 #include "ea.hpp"
 #include "renderer.hpp"
+#include "telemetry.hpp"
+#include "triple_buffer.hpp"
 #include "utils.hpp"
 
 struct AbstractRunner {
@@ -22,78 +28,335 @@ struct AbstractRunner {
 	std::vector<World> worldLevels;
 
 	bool debugFlag = false;
-	bool saveFlag = false;
+	bool verbose = true; // per-generation report on the console
+	std::atomic<bool> saveFlag{false}; // set by the window thread, the evolution takes it
 	bool updateDoneFlag = false; 
 
+	// every historyInterval-th generation goes to the run's checkpoint history (0 = off)
+	uint64_t historyInterval = 0;
+	std::unique_ptr<CheckpointHistory> history; // before the writer - its pending appends finish first
+
+	// saves run in the background, the destructor waits for the pending ones
+	CheckpointWriter checkpointWriter;
+
+	virtual ~AbstractRunner() {}
+
 	virtual void prepare(const std::vector<World> &levels) = 0;
 	virtual void run(Drone &drone, std::unique_ptr<AbstractEA> ea, const int maxGen=-1, const std::string &note="") = 0;
 
-	void saveProcedure(const AbstractEA &ea, const std::string &note) const {
+	// returns the path the checkpoint is queued for
+	std::string saveProcedure(const AbstractEA &ea, const std::string &note) {
+		return saveProcedure(ea, note, currentLevel);
+	}
+
+	std::string saveProcedure(const AbstractEA &ea, const std::string &note, const int level) {
 		std::cout << "SAVING..." << std::endl;
 
 		int64_t timestamp = std::chrono::system_clock::now().time_since_epoch().count();
-		ea.saveEA("ea_save_" + note + "_" + std::to_string(ea.generation) + "_" + std::to_string(ea.lastFitnessStats.max) + "_" + std::to_string(timestamp));   
+		const std::string name = "ea_save_" + note + "_" + std::to_string(ea.generation) + "_" + std::to_string(ea.lastFitnessStats.max) + "_" + std::to_string(timestamp);
+		ea.saveEA(name, checkpointWriter, runnerState(level), latestPath(note));
+
+		std::cout << "SAVE QUEUED" << std::endl;
+		return "saves/" + name + ".ckpt";
+	}
+
+	// population only, delta encoded against the previous record (see CheckpointHistory)
+	void historyProcedure(const AbstractEA &ea, const std::string &note) {
+		if (!history) {
+			history = std::make_unique<CheckpointHistory>("saves/history_" + (note.empty() ? ea.typeName() : note));
+		}
+
+		EASnapshot snap = checkpointWriter.acquire();
+		ea.takeSnapshot(snap, false);
+		checkpointWriter.submit(*history, std::move(snap));
+	}
+
+	// pointer to the newest checkpoint of a run (runs are told apart by their note)
+	static std::string latestPath(const std::string &note) {
+		return "saves/latest_" + note + ".txt";
+	}
+
+	// level + its goals (randomized levels move them every generation)
+	json runnerState(const int level) const {
+		json goals = json::array();
+		for (auto && g : worldLevels[level].goals) {
+			goals.push_back({g.x, g.y});
+		}
 
-		std::cout << "ALL SAVED" << std::endl;
+		return json{{"level", level}, {"goals", goals}};
+	}
+
+	// continues the run from its newest checkpoint, false when there is nothing to resume
+	bool resumeProcedure(AbstractEA &ea, const std::string &note) {
+		const std::string path = Checkpoint::readLatest(latestPath(note));
+		if (path.empty()) {
+			std::cout << "NOTHING TO RESUME - starting a new run" << std::endl;
+			return false;
+		}
+
+		CheckpointView checkpoint(path);
+		if (checkpoint.type() != ea.typeName() || checkpoint.header().popSize != ea.populationSize()) {
+			std::cout << "CHECKPOINT " << path << " DOES NOT MATCH THE EA (" << checkpoint.type() << ", "
+					  << checkpoint.header().popSize << ") - starting a new run" << std::endl;
+			return false;
+		}
+
+		ea.restore(checkpoint);
+
+		const json state = checkpoint.state();
+		if (!state.is_null() && state.contains("runner")) {
+			const json &runner = state["runner"];
+			currentLevel = runner["level"];
+
+			auto &goals = worldLevels[currentLevel].goals;
+			for (size_t g = 0; g < goals.size() && g < runner["goals"].size(); ++g) {
+				goals[g] = sf::Vector2f{runner["goals"][g][0], runner["goals"][g][1]};
+			}
+		}
+
+		std::cout << "RESUMED FROM " << path << " --- Gen: " << ea.generation << " Lvl: " << currentLevel << std::endl;
+		return true;
 	}
 
 	void levelUpProcedure(const AbstractEA &ea) {
-		if (ea.lastFitnessStats.max > 40000 && currentLevel+1 < worldLevels.size()) {
+		levelUpProcedure(ea, currentLevel);
+	}
+
+	void levelUpProcedure(const AbstractEA &ea, int &level) const {
+		if (ea.lastFitnessStats.max > 40000 && level+1 < worldLevels.size()) {
 			/* std::cout << "[WARN] LEVEL UP DISSABLED!" << std::endl; */
-			currentLevel += 1;
+			level += 1;
 		}
 	}
 
 	void debugPrintProcedure(const AbstractEA &ea) const { 
-		printf("Gen: %lu Lvl: %d --- BF: %.3f AVGF: %.3f\n", ea.generation, currentLevel, ea.lastFitnessStats.max, ea.lastFitnessStats.avg);
-	}
+		if (!verbose) return;
+
+		printf("Gen: %lu Lvl: %d --- BF: %.3f AVGF: %.3f --- LIVE: %.1f%% of %lu ticks\n", ea.generation, currentLevel, ea.lastFitnessStats.max, ea.lastFitnessStats.avg,
+			   100.0f * ea.lastLiveStats.meanLiveFraction, ea.lastLiveStats.ticks);
 
-	void fitStatsSave(const AbstractEA &ea, std::ofstream &os) const {
-        os << std::to_string(ea.generation) + "," + std::to_string(ea.lastFitnessStats.max) + ","
-		  										  + std::to_string(ea.lastFitnessStats.min) + ","
-		  										  + std::to_string(ea.lastFitnessStats.avg) + ","
-		  										  + std::to_string(ea.lastFitnessStats.med) + "," << std::endl;
+		if (ea.racing != RacingMode::Off) {
+			const RacingStats &rs = ea.lastRacingStats;
+			printf("    Racing: killed %lu --- steps %lu saved %lu (%.1f%%)\n", rs.killed, rs.steps, rs.savedSteps,
+				   100.0 * rs.savedSteps / std::max<uint64_t>(1, rs.steps + rs.savedSteps));
+		}
+
+		if (ea.fitnessCache) {
+			printf("    Cache: %lu/%lu hits --- entries %zu\n", ea.lastCacheStats.hits, ea.lastCacheStats.lookups, ea.fitnessCache->size());
+		}
+
+		if (ea.surrogate) {
+			printf("    Surrogate: %lu simulated, %lu imputed --- MAE %.2f --- history %zu\n",
+				   ea.lastSurrogateStats.simulated, ea.lastSurrogateStats.imputed, ea.lastSurrogateStats.meanAbsError, ea.surrogate->size());
+		}
+
+		if (ea.multiObjective) {
+			const MultiObjectiveStats &ms = ea.multiObjective->lastStats();
+			printf("    Pareto: %zu fronts --- first front %zu\n", ms.fronts, ms.paretoSize);
+		}
 	}
 };
 
+// Limits of a console run, 0 = no limit. Budgets count from the start of run() (a resumed run
+// gets a fresh budget), they are checked after every generation.
+struct RunBudget {
+	double maxSeconds = 0;       // wall clock
+	uint64_t maxEvaluations = 0; // simulated episodes - cache hits and surrogate-imputed individuals are free
+
+	// early stopping - the best fitness did not improve by more than plateauEpsilon in plateauWindow generations
+	uint64_t plateauWindow = 0;
+	float plateauEpsilon = 0;
+};
+
 struct ConsoleRunner : public AbstractRunner {
+	// continue from the newest checkpoint of the run (same note) if there is one
+	bool autoResume = false;
+
+	// per-generation fitness stats + phase timings to fits/ (see TelemetryLog)
+	bool telemetry = false;
+
+	// a run that ends on maxGen or a budget writes a final checkpoint and saves/summary_<note>.json
+	RunBudget budget;
+
 	void prepare(const std::vector<World> &levels) override {
 		currentLevel = 0;
 		worldLevels = levels;
 	}
 
 	void run(Drone &drone, std::unique_ptr<AbstractEA> ea, const int maxGen, const std::string &note) override {
+		if (autoResume) {
+			resumeProcedure(*ea, note);
+		}
 
-		/* std::string outpath = "fits/" + note + ".csv"; */
-		/* std::ofstream os(outpath); */
-		/* if (note == "") { */
-		/* 	os.close(); */
-		/* } */
+		std::unique_ptr<TelemetryLog> log;
+		if (telemetry) {
+			log = std::make_unique<TelemetryLog>(note.empty() ? ea->typeName() : note);
+			ea->timePhases = true;
+		}
+
+		const auto runStart = std::chrono::steady_clock::now();
+		const uint64_t firstGeneration = ea->generation;
+		progress = RunProgress{.level = currentLevel, .plateauGeneration = ea->generation};
+		progress.levelBest.assign(worldLevels.size(), LevelBest{});
 
-		while ((maxGen > 0) ? (ea->generation < maxGen) : true) 
+		PhaseTimes times;
+		std::string stopReason;
+		while (stopReason.empty() && ((maxGen > 0) ? (ea->generation < maxGen) : true)) 
 		{
 			// EA LOGIC
+			auto start = PhaseTimes::Clock::now();
 			updateDoneFlag = ea->update(dt, worldLevels[currentLevel], false);
+			times.simulation += PhaseTimes::since(start);
 
 			// if at the end ea sim was finished, do the EA process, reset and the timing
 			if (updateDoneFlag) {
 				updateDoneFlag = false;
 
+				start = PhaseTimes::Clock::now();
 				ea->process();
+				times.selection = PhaseTimes::since(start);
 
 				debugPrintProcedure(*ea);
 
 				levelUpProcedure(*ea);
 
+				start = PhaseTimes::Clock::now();
 				if (ea->generation % 1000 == 0) {
-				    saveProcedure(*ea, note);
+				    progress.checkpoint = saveProcedure(*ea, note);
+				    progress.checkpointGeneration = ea->generation;
+				}
+				if (historyInterval > 0 && ea->generation % historyInterval == 0) {
+					historyProcedure(*ea, note);
+				}
+
+				if (log) {
+					// update() time minus what stepAgent measured inside it
+					times.sensors = ea->phaseTimes.sensors;
+					times.inference = ea->phaseTimes.inference;
+					times.simulation -= times.sensors + times.inference;
+					times.io = PhaseTimes::since(start);
+
+					log->record(*ea, times);
 				}
 
-				/* if (os.is_open()) { */
-				/* 	fitStatsSave(*ea, os); */
-				/* } */
+				times = PhaseTimes();
+				ea->phaseTimes = PhaseTimes();
+
+				stopReason = budgetProcedure(*ea, runStart);
 			}
 		}
+
+		if (stopReason.empty()) stopReason = "maxGen";
+		summaryProcedure(*ea, note, stopReason, runStart, firstGeneration);
+	}
+
+private:
+	// fitness of different levels is not comparable (a harder level scores lower)
+	struct LevelBest {
+		float fitness = std::numeric_limits<float>::lowest();
+		uint64_t generation = 0;
+	};
+
+	struct RunProgress {
+		uint64_t evaluations = 0;
+		int level = 0; // the level the last generation was evaluated on
+		std::vector<LevelBest> levelBest; // best max fitness of the run per level
+		float plateauBest = std::numeric_limits<float>::lowest(); // last best that improved by more than epsilon
+		uint64_t plateauGeneration = 0;
+		std::string checkpoint; // newest checkpoint of the run
+		uint64_t checkpointGeneration = 0;
+	};
+	RunProgress progress;
+
+	// empty while the run may go on, otherwise what stopped it
+	std::string budgetProcedure(const AbstractEA &ea, const std::chrono::steady_clock::time_point &start) {
+		progress.evaluations += ea.populationSize();
+		if (ea.fitnessCache) progress.evaluations -= ea.lastCacheStats.hits;
+		if (ea.surrogate) progress.evaluations -= ea.lastSurrogateStats.imputed;
+
+		// the stats are of the level before a level up in this generation
+		const float best = ea.lastFitnessStats.max;
+		LevelBest &levelBest = progress.levelBest[progress.level];
+		if (best > levelBest.fitness) {
+			levelBest = LevelBest{best, ea.generation};
+		}
+		if (best > progress.plateauBest + budget.plateauEpsilon) {
+			progress.plateauBest = best;
+			progress.plateauGeneration = ea.generation;
+		}
+
+		// a new level starts a new plateau window
+		if (currentLevel != progress.level) {
+			progress.level = currentLevel;
+			progress.plateauBest = std::numeric_limits<float>::lowest();
+			progress.plateauGeneration = ea.generation;
+		}
+
+		if (budget.maxSeconds > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= budget.maxSeconds) {
+			return "wall clock";
+		}
+		if (budget.maxEvaluations > 0 && progress.evaluations >= budget.maxEvaluations) {
+			return "evaluations";
+		}
+		if (budget.plateauWindow > 0 && ea.generation - progress.plateauGeneration >= budget.plateauWindow) {
+			return "plateau";
+		}
+		return "";
+	}
+
+	// final checkpoint + what the run did, for the scripts that launched it
+	void summaryProcedure(const AbstractEA &ea, const std::string &note, const std::string &reason,
+						  const std::chrono::steady_clock::time_point &start, const uint64_t firstGeneration) {
+		// the run may have stopped right on a periodic save
+		if (progress.checkpoint.empty() || progress.checkpointGeneration != ea.generation) {
+			progress.checkpoint = saveProcedure(ea, note);
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// [fitness, generation] per level, null for levels the run never reached
+		json bestPerLevel = json::array();
+		for (auto && b : progress.levelBest) {
+			bestPerLevel.push_back((b.generation == 0) ? json() : json{b.fitness, b.generation});
+		}
+		// the highest level the run evaluated a generation on (a level up in the last generation has none yet)
+		size_t bestLevel = 0;
+		for (size_t l = 0; l < progress.levelBest.size(); ++l) {
+			if (progress.levelBest[l].generation > 0) bestLevel = l;
+		}
+		const LevelBest &best = progress.levelBest[bestLevel];
+
+		const json summary = {
+			{"type", ea.typeName()},
+			{"note", note},
+			{"stopReason", reason},
+			{"generation", ea.generation},
+			{"generationsRun", ea.generation - firstGeneration},
+			{"evaluations", progress.evaluations},
+			{"seconds", seconds},
+			{"bestFitness", best.fitness},
+			{"bestGeneration", best.generation},
+			{"bestLevel", bestLevel},
+			{"bestPerLevel", bestPerLevel},
+			{"lastFitnessStats", {ea.lastFitnessStats.max, ea.lastFitnessStats.min, ea.lastFitnessStats.avg, ea.lastFitnessStats.med}},
+			{"level", currentLevel},
+			{"checkpoint", progress.checkpoint},
+			{"budget", {
+				{"maxSeconds", budget.maxSeconds},
+				{"maxEvaluations", budget.maxEvaluations},
+				{"plateauWindow", budget.plateauWindow},
+				{"plateauEpsilon", budget.plateauEpsilon},
+			}},
+		};
+
+		const std::string path = "saves/summary_" + (note.empty() ? ea.typeName() : note) + ".json";
+		std::ofstream file(path);
+		file << summary.dump(4);
+		file.close();
+
+		printf("STOPPED (%s) --- Gen: %lu (%lu this run) --- %lu evaluations in %.1f s --- Lvl %d BF %.3f at gen %lu\n", reason.c_str(),
+			   (unsigned long)ea.generation, (unsigned long)(ea.generation - firstGeneration), (unsigned long)progress.evaluations, seconds,
+			   (int)bestLevel, best.fitness, (unsigned long)best.generation);
+		std::cout << "Summary written to: " << path << std::endl;
 	}
 };
 
@@ -104,6 +367,7 @@ struct EAWindowRunner : public AbstractRunner {
 	std::unique_ptr<sf::CircleShape> goalPrefab;
 
 	std::unique_ptr<Renderer> renderer;
+	std::unique_ptr<PopulationRenderer> populationRenderer;
 
 	virtual void prepare(const std::vector<World> &levels) override {
 		currentLevel = 0;
@@ -126,9 +390,22 @@ struct EAWindowRunner : public AbstractRunner {
 		goalPrefab->setFillColor(sf::Color(240,190,4));
 
 		renderer = std::make_unique<Renderer>();
+		populationRenderer = std::make_unique<PopulationRenderer>();
 	}
 
+	// evolution runs on a worker thread as fast as in the console, the window only
+	// shows the newest published state of the leading drone of the running episode
 	void run(Drone &drone, std::unique_ptr<AbstractEA> ea, const int maxGen, const std::string &note) override {
+		assert(ea->typeName() != "SteadyStateEA" && "SteadyStateEA evaluates on its workers, its drones never move - run it in the console");
+		stopFlag = false;
+		shownIndex = 0;
+		std::thread worker([&]{ evolve(*ea, maxGen, note); });
+
+		DroneSnapshot shown;
+		Drone viewDrone{droneStart};
+		World viewWorld;
+		int viewLevel = -1;
+
 		sf::Event event;
 		while (window->isOpen()) 
 		{
@@ -149,67 +426,158 @@ struct EAWindowRunner : public AbstractRunner {
 					saveFlag = true;
 					std::cout << "SAVE STATE to TRUE" << std::endl;
 				}
+				if ((event.type == sf::Event::KeyPressed) && (event.key.code == sf::Keyboard::F3)) {
+					showPopulation = !showPopulation;
+				}
 			}
 
-			window->clear();
-
-			for (auto && w : worldLevels[currentLevel].walls) {
-				wallPrefab->setPosition(w.pos);
-				wallPrefab->setRadius(w.radius);
-				wallPrefab->setOrigin(w.radius,w.radius);
-
-				window->draw(*wallPrefab);
+			if (snapshots.update()) {
+				shown = snapshots.front();
 			}
 
-			/* sf::Vector2i mp = sf::Mouse::getPosition(*window); */
-			/* drone.pos = sf::Vector2f{mp}; */
+			window->clear();
 
-			// EA LOGIC
-			updateDoneFlag = ea->update(dt, worldLevels[currentLevel], ea->generation % 500 == 0);
+			if (shown.level >= 0) {
+				// the worker never touches the walls, only the goals of randomized levels
+				if (shown.level != viewLevel) {
+					viewLevel = shown.level;
+					viewWorld = World{worldLevels[viewLevel].boundary, worldLevels[viewLevel].walls, {}};
+				}
+				viewWorld.goals = {shown.goal};
 
-			if (ea->generation % 500 == 0) {
-				EAItem best = (*ea)[0];
+				for (auto && w : viewWorld.walls) {
+					wallPrefab->setPosition(w.pos);
+					wallPrefab->setRadius(w.radius);
+					wallPrefab->setOrigin(w.radius,w.radius);
 
-				goalPrefab->setPosition(worldLevels[currentLevel].goals[best.drone->goalIndex % worldLevels[currentLevel].goals.size()]);
-				renderer->draw_body(best.drone, window.get());
-				if (debugFlag) {
-					renderer->draw_debug(best.drone, worldLevels[currentLevel], {}, window.get());
+					window->draw(*wallPrefab);
 				}
 
-				window->draw(*goalPrefab);
-				window->display();
+				if (!shown.population.empty()) {
+					// every live drone + every goal of the level (+ the sensor rays with F2) in one draw call
+					World level{viewWorld.boundary, viewWorld.walls, shown.goals};
+
+					populationRenderer->begin();
+					populationRenderer->addGoals(level);
+					for (size_t i = 0; i < shown.population.size(); ++i) {
+						shown.population[i].apply(viewDrone, level);
+						populationRenderer->add(viewDrone);
+
+						if (debugFlag) {
+							// the rays point along the velocity
+							viewDrone.vel = shown.populationVel[i];
+							populationRenderer->addSensors(viewDrone, level);
+						}
+					}
+					populationRenderer->draw(window.get());
+				}
+				else {
+					shown.frame.apply(viewDrone);
+					viewDrone.vel = shown.vel;
+					viewDrone.goalTimer = shown.goalTimer;
+
+					renderer->draw_body(&viewDrone, window.get());
+					if (debugFlag) {
+						renderer->draw_debug(&viewDrone, viewWorld, {}, window.get());
+					}
+
+					goalPrefab->setPosition(shown.goal);
+					window->draw(*goalPrefab);
+				}
 			}
 
-			// SINGLE LOGIC
-			/* drone.update(dt, worldLevels[currentLevel]); */
-			/* renderer->draw_body(&drone, window.get()); */
-			/* if (debugFlag) { */
-			/*     renderer->draw_debug(&drone,worldLevels[currentLevel], {}, window.get()); */
-			/* } */
-			/* std::vector<float> obs(17); */
-			/* drone.genObservation_with_sensors(obs, worldLevels[currentLevel]); */
-			/* window->draw(*goalPrefab); */
-			/* window->display(); */
+			window->display();
+		}
+
+		stopFlag = true;
+		worker.join();
+	}
+
+	// evolution loop of the worker thread - publishes the state of the leading drone after every tick
+	void evolve(AbstractEA &ea, const int maxGen, const std::string &note) {
+		while (!stopFlag && ((maxGen > 0) ? (ea.generation < maxGen) : true)) 
+		{
+			// EA LOGIC
+			updateDoneFlag = ea.update(dt, worldLevels[currentLevel], false);
+			publish(ea);
 
 			// if at the end ea sim was finished, do the EA process, reset and the timing
 			if (updateDoneFlag) {
 				updateDoneFlag = false;
 
-				ea->process();
+				ea.process();
 				worldLevels[currentLevel].randomize();
 
-				debugPrintProcedure(*ea);
-
-				levelUpProcedure(*ea);
+				debugPrintProcedure(ea);
 
-				if (saveFlag) {
-					saveFlag = false;
+				levelUpProcedure(ea);
 
-					saveProcedure(*ea, note);
+				if (saveFlag.exchange(false)) {
+					saveProcedure(ea, note);
 				}
 			}
 		}
 	}
+
+	// what the window draws of a drone - written by the worker, read by the window thread
+	struct DroneSnapshot {
+		TrajectoryFrame frame{};
+		sf::Vector2f vel;
+		size_t goalTimer = 0;
+		sf::Vector2f goal;  // the drone's current goal
+		int level = -1;     // -1 = nothing published yet
+		uint64_t generation = 0;
+
+		// with showPopulation - every live drone (+ its velocity for the sensors) and the goals of the level
+		std::vector<TrajectoryFrame> population;
+		std::vector<sf::Vector2f> populationVel;
+		std::vector<sf::Vector2f> goals;
+	};
+
+	TripleBuffer<DroneSnapshot> snapshots;
+
+	// whole population instead of the best drone (F3)
+	std::atomic<bool> showPopulation{false};
+
+protected:
+	std::atomic<bool> stopFlag{false};
+
+	// drone shown by the window, stays on the last leader once the episode is over (worker thread only)
+	size_t shownIndex = 0;
+
+	void publish(AbstractEA &ea) {
+		// individual 0 can be a cache hit or imputed, follow the best drone actually flying
+		const int leader = ea.leader();
+		if (leader >= 0) shownIndex = leader;
+
+		const Drone &best = *ea[shownIndex].drone;
+		const World &world = worldLevels[currentLevel];
+
+		DroneSnapshot &snap = snapshots.back();
+		snap.frame = TrajectoryFrame::capture(best);
+		snap.vel = best.vel;
+		snap.goalTimer = best.goalTimer;
+		snap.goal = world.goals[best.goalIndex % world.goals.size()];
+		snap.level = currentLevel;
+		snap.generation = ea.generation;
+
+		// the slots keep their capacity, no allocation once they have seen a full population
+		snap.population.clear();
+		snap.populationVel.clear();
+		snap.goals.clear();
+		if (showPopulation) {
+			for (size_t i = 0; i < ea.populationSize(); ++i) {
+				const Drone &drone = *ea[i].drone;
+				if (!drone.alive) continue;
+
+				snap.population.push_back(TrajectoryFrame::capture(drone));
+				snap.populationVel.push_back(drone.vel);
+			}
+			snap.goals = world.goals;
+		}
+
+		snapshots.publish();
+	}
 };
 
 struct HumanRunner : public EAWindowRunner {
@@ -286,3 +654,164 @@ struct HumanRunner : public EAWindowRunner {
 	}
 };
 
+// Plays a trajectory log (see TrajectoryRecorder) - no simulation, no inference, the recorded
+// frames are put on drones and drawn. The ea passed to run() is not used (can be null).
+//
+//   Space       pause
+//   Left/Right  seek -/+ 1 s        Up/Down    next/previous recorded generation
+//   PgUp/PgDn   +/- 10 generations  Home/End   first/last generation
+//   +/-         speed x2 / x0.5 (1/8 up to 64x)
+//   1-9         only that rank      0          overlay of every recorded rank
+//   F1/F2       paths off/on        R          reopen the log (it grows while a run records)
+struct ReplayRunner : public EAWindowRunner {
+	ReplayRunner(const std::string &logPath, const uint64_t startGeneration = 0) : logPath(logPath), startGeneration(startGeneration) {}
+
+	void run(Drone &drone, std::unique_ptr<AbstractEA> ea, const int maxGen, const std::string &note) override {
+		auto log = std::make_unique<TrajectoryView>(logPath);
+		if (log->generations().empty()) {
+			std::cout << "Trajectory log " << logPath << " has no complete episode" << std::endl;
+			return;
+		}
+
+		size_t genIndex = std::lower_bound(log->generations().begin(), log->generations().end(), startGeneration) - log->generations().begin();
+		genIndex = std::min(genIndex, log->generations().size() - 1);
+
+		int focus = -1; // rank drawn alone, -1 = overlay
+		double tick = 0;
+		double speed = 1;
+		bool paused = false;
+		debugFlag = true;
+
+		std::vector<std::unique_ptr<Drone>> drones;
+		std::vector<sf::VertexArray> paths;
+
+		sf::Event event;
+		while (window->isOpen()) 
+		{
+			const size_t gens = log->generations().size();
+
+			// EVENTS
+			while (window->pollEvent(event)) {
+				if ((event.type == sf::Event::Closed) ||
+					((event.type == sf::Event::KeyPressed) && (event.key.code == sf::Keyboard::Escape))) {
+					window->close();
+					break;
+				}
+				if (event.type != sf::Event::KeyPressed) continue;
+
+				const size_t lastGen = genIndex;
+				switch (event.key.code) {
+					case sf::Keyboard::Space:    paused = !paused; break;
+					case sf::Keyboard::Left:     tick = std::max(0.0, tick - 60); break;
+					case sf::Keyboard::Right:    tick += 60; break;
+					case sf::Keyboard::Up:       genIndex = std::min(genIndex + 1, gens - 1); break;
+					case sf::Keyboard::Down:     genIndex = (genIndex > 0) ? genIndex - 1 : 0; break;
+					case sf::Keyboard::PageUp:   genIndex = std::min(genIndex + 10, gens - 1); break;
+					case sf::Keyboard::PageDown: genIndex = (genIndex > 10) ? genIndex - 10 : 0; break;
+					case sf::Keyboard::Home:     genIndex = 0; break;
+					case sf::Keyboard::End:      genIndex = gens - 1; break;
+					case sf::Keyboard::Add:      speed = std::min(speed * 2, 64.0); break;
+					case sf::Keyboard::Subtract: speed = std::max(speed * 0.5, 0.125); break;
+					case sf::Keyboard::Num0:     focus = -1; break;
+					case sf::Keyboard::F1:       debugFlag = false; break;
+					case sf::Keyboard::F2:       debugFlag = true; break;
+					case sf::Keyboard::R: {
+						const uint64_t current = log->generations()[genIndex];
+						log = std::make_unique<TrajectoryView>(logPath);
+						genIndex = std::lower_bound(log->generations().begin(), log->generations().end(), current) - log->generations().begin();
+						genIndex = std::min(genIndex, log->generations().size() - 1);
+						std::cout << "REPLAY: " << log->episodes().size() << " episodes of " << log->generations().size() << " generations" << std::endl;
+						break;
+					}
+					default:
+						if (event.key.code >= sf::Keyboard::Num1 && event.key.code <= sf::Keyboard::Num9) {
+							focus = event.key.code - sf::Keyboard::Num1;
+						}
+						break;
+				}
+				if (genIndex != lastGen) tick = 0;
+			}
+
+			const uint64_t generation = log->generations()[genIndex];
+			std::vector<const TrajectoryEpisode*> episodes = log->generation(generation);
+			if (focus >= (int)episodes.size()) focus = -1;
+			if (focus >= 0) {
+				episodes = {episodes[focus]};
+			}
+
+			size_t length = 0;
+			for (auto && e : episodes) {
+				length = std::max(length, e->frameCount());
+			}
+
+			// the end of a generation goes on with the next one
+			if (tick >= length) {
+				if (genIndex + 1 < log->generations().size()) {
+					genIndex += 1;
+					tick = 0;
+					continue;
+				}
+				tick = length - 1;
+				paused = true;
+			}
+			const size_t t = tick;
+
+			window->clear();
+
+			// all recorded ranks of a generation fly the same world
+			const World world = episodes[0]->world();
+			for (auto && w : world.walls) {
+				wallPrefab->setPosition(w.pos);
+				wallPrefab->setRadius(w.radius);
+				wallPrefab->setOrigin(w.radius,w.radius);
+
+				window->draw(*wallPrefab);
+			}
+
+			while (drones.size() < episodes.size()) {
+				drones.push_back(std::make_unique<Drone>(droneStart));
+				paths.emplace_back(sf::LineStrip);
+			}
+
+			// best last, so it's drawn on top
+			for (size_t e = episodes.size(); e-- > 0;) {
+				const TrajectoryEpisode &episode = *episodes[e];
+				Drone &d = *drones[e];
+				episode.frame(t).apply(d, world);
+
+				if (debugFlag) {
+					const size_t end = std::min(t + 1, episode.frameCount());
+					const sf::Color color = pathColor(episode.header.rank);
+					paths[e].resize(end);
+					for (size_t f = 0; f < end; ++f) {
+						paths[e][f] = sf::Vertex(sf::Vector2f{episode.frames[f].x, episode.frames[f].y}, color);
+					}
+					window->draw(paths[e]);
+				}
+
+				renderer->draw_body(&d, window.get());
+			}
+
+			goalPrefab->setPosition(world.goals[drones[0]->goalIndex % world.goals.size()]);
+			window->draw(*goalPrefab);
+			window->display();
+
+			char title[160];
+			std::snprintf(title, sizeof(title), "GoodBoyDrone replay - gen %lu (%zu/%zu) - %s - tick %zu/%zu - %gx%s",
+						  (unsigned long)generation, genIndex + 1, log->generations().size(),
+						  (focus >= 0) ? ("rank " + std::to_string(focus)).c_str() : "overlay", t, length, speed, paused ? " - paused" : "");
+			window->setTitle(title);
+
+			if (!paused) tick += speed;
+		}
+	}
+
+private:
+	const std::string logPath;
+	const uint64_t startGeneration;
+
+	static sf::Color pathColor(const uint32_t rank) {
+		static const sf::Color colors[] = {sf::Color::Green, sf::Color::Cyan, sf::Color::Yellow, sf::Color::Magenta, sf::Color(255,128,0), sf::Color(128,128,255)};
+		return colors[rank % (sizeof(colors) / sizeof(colors[0]))];
+	}
+};
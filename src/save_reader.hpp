@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "net.hpp"
+
+// Streaming reader of the JSON saves - nlohmann's SAX interface instead of a DOM.
+// The weights go straight from the parser into a snapshot's flat buffer, no json node
+// is ever built for them (a DOM of a big save takes several times the size of its floats).
+//
+// The saves are dumped with sorted keys, so "motherNet" and "popSize" come before "popW"
+// and the buffer can be laid out before the first genome. Files in another order are
+// reported as not streamable and the caller falls back to the DOM.
+struct SaveReader : public nlohmann::json_sax<json> {
+	// false - not a save this reader can stream (the snapshot is left incomplete)
+	static bool read(const std::string &path, EASnapshot &snap) {
+		// the stream adapter reads through the streambuf, the FILE* one takes a locked fgetc per character
+		std::ifstream input(path, std::ios::binary);
+		if (!input) {
+			throw std::runtime_error("Cannot open EA save: " + path);
+		}
+
+		SaveReader reader(snap);
+		const bool parsed = json::sax_parse(input, &reader);
+
+		if (reader.error.size()) {
+			throw std::runtime_error("EA save " + path + ": " + reader.error);
+		}
+
+		return parsed && reader.finished();
+	}
+
+	bool null() override {
+		return value(json());
+	}
+
+	bool boolean(bool val) override {
+		return value(val);
+	}
+
+	bool number_integer(number_integer_t val) override {
+		return inGenome() ? weight(val) : value(val);
+	}
+
+	bool number_unsigned(number_unsigned_t val) override {
+		return inGenome() ? weight(val) : value(val);
+	}
+
+	bool number_float(number_float_t val, const string_t &) override {
+		return inGenome() ? weight(val) : value(val);
+	}
+
+	bool string(string_t &val) override {
+		return value(val);
+	}
+
+	bool binary(binary_t &val) override {
+		return value(json::binary(val));
+	}
+
+	bool start_object(std::size_t) override {
+		depth += 1;
+
+		if (capturing()) {
+			return open(json::object());
+		}
+		if (depth == 2 && topKey == "motherNet") {
+			mother = json::object();
+			captureStack.push_back(&mother);
+			return true;
+		}
+		if (depth == 2 && topKey == "popW") {
+			// from here on every genome goes straight into the buffer
+			if (!snap.popSize || mother.is_null()) return false;
+			inPopW = true;
+
+			snap.setLayout(snap.popSize, Net::loadConfig(mother).getWeights().size());
+			loaded.assign(snap.popSize, false);
+			return true;
+		}
+
+		return true;
+	}
+
+	bool end_object() override {
+		if (capturing()) captureStack.pop_back();
+		if (depth == 2 && topKey == "motherNet") snap.motherDescription = mother;
+		if (depth == 2) inPopW = false;
+
+		depth -= 1;
+		return true;
+	}
+
+	bool key(string_t &val) override {
+		if (capturing()) {
+			captureKey = val;
+			return true;
+		}
+
+		if (depth == 1) {
+			topKey = val;
+		}
+		else if (depth == 2 && inPopW) {
+			if (val.empty() || val.find_first_not_of("0123456789") != std::string::npos ||
+				(genomeIndex = std::stoul(val)) >= snap.popSize) {
+				error = "genome " + val + " is outside of the population";
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool start_array(std::size_t) override {
+		depth += 1;
+
+		if (capturing()) {
+			return open(json::array());
+		}
+		if (depth == 3 && inPopW) {
+			genomeFill = 0;
+		}
+
+		return true;
+	}
+
+	bool end_array() override {
+		if (capturing()) {
+			captureStack.pop_back();
+		}
+		else if (inGenome()) {
+			if (genomeFill != snap.genomeSize) {
+				error = "genome " + std::to_string(genomeIndex) + " has " + std::to_string(genomeFill) + " weights, the net " + std::to_string(snap.genomeSize);
+				return false;
+			}
+			loaded[genomeIndex] = true;
+		}
+
+		depth -= 1;
+		return true;
+	}
+
+	bool parse_error(std::size_t, const std::string &, const nlohmann::detail::exception &e) override {
+		error = e.what();
+		return false;
+	}
+
+private:
+	EASnapshot &snap;
+
+	size_t depth = 0;
+	std::string topKey;
+	bool inPopW = false; // inside the popW object - checked for every weight
+
+	// motherNet is small and goes to a json as usual
+	json mother;
+	std::vector<json*> captureStack;
+	std::string captureKey;
+
+	size_t genomeIndex = 0;
+	size_t genomeFill = 0;
+	std::vector<bool> loaded;
+
+	std::string error;
+
+	SaveReader(EASnapshot &snap) : snap(snap) {}
+
+	bool capturing() const {
+		return !captureStack.empty();
+	}
+
+	bool inGenome() const {
+		return depth == 3 && inPopW;
+	}
+
+	bool weight(const double w) {
+		if (genomeFill == snap.genomeSize) {
+			genomeFill += 1; // reported by end_array
+			return true;
+		}
+
+		snap.genome(genomeIndex)[genomeFill++] = static_cast<float>(w);
+		return true;
+	}
+
+	// scalar at the top level (type, popSize, ...) or inside the captured mother
+	bool value(json val) {
+		if (capturing()) {
+			json &top = *captureStack.back();
+			if (top.is_object()) top[captureKey] = std::move(val);
+			else top.push_back(std::move(val));
+			return true;
+		}
+
+		if (depth == 1 && topKey == "type" && val.is_string()) snap.type = val;
+		if (depth == 1 && topKey == "popSize" && val.is_number_unsigned()) snap.popSize = val;
+
+		return true;
+	}
+
+	// nested object/array inside the captured mother
+	bool open(json container) {
+		json &top = *captureStack.back();
+		if (top.is_object()) {
+			top[captureKey] = std::move(container);
+			captureStack.push_back(&top[captureKey]);
+		}
+		else {
+			top.push_back(std::move(container));
+			captureStack.push_back(&top.back());
+		}
+		return true;
+	}
+
+	// type + every genome of the population
+	bool finished() const {
+		return !snap.type.empty() && !loaded.empty() && std::find(loaded.begin(), loaded.end(), false) == loaded.end();
+	}
+};
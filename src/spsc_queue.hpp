@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free single-producer/single-consumer ring buffer.
+// Neither side ever blocks - push fails when full, pop fails when empty.
+template <typename T>
+struct SpscQueue {
+	explicit SpscQueue(size_t capacity) : buffer(capacity + 1) {}
+
+	SpscQueue(const SpscQueue &) = delete;
+	SpscQueue &operator=(const SpscQueue &) = delete;
+
+	// producer side
+	bool push(T &&item) {
+		const size_t t = tail.load(std::memory_order_relaxed);
+		const size_t next = (t + 1) % buffer.size();
+
+		if (next == head.load(std::memory_order_acquire)) return false;
+
+		buffer[t] = std::move(item);
+		tail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	// consumer side
+	bool pop(T &item) {
+		const size_t h = head.load(std::memory_order_relaxed);
+
+		if (h == tail.load(std::memory_order_acquire)) return false;
+
+		item = std::move(buffer[h]);
+		head.store((h + 1) % buffer.size(), std::memory_order_release);
+		return true;
+	}
+
+	bool empty() const {
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+	}
+
+private:
+	std::vector<T> buffer;
+
+	// keep the two indices on separate cache lines
+	alignas(64) std::atomic<size_t> head{0};
+	alignas(64) std::atomic<size_t> tail{0};
+};
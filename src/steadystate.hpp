@@ -0,0 +1,366 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "ea.hpp"
+
+// Steady-state EA without a generational barrier. Worker threads keep pulling
+// work (initial individuals, migrants, then freshly bred offspring), simulate
+// a single episode and insert the result into the shared population right away.
+// Every slot has its own lock, so workers only contend on the slots they touch.
+//
+// For the runners popSize finished evaluations count as one "generation":
+// update() blocks until they are done and process() just takes the statistics,
+// the workers never stop in between.
+//
+// A changed world (runners randomize their levels in place) makes every slot's
+// fitness stale - the workers evaluate the population again before they breed.
+// These re-evaluations don't count towards a generation.
+//
+// There is no shared episode, so racing, the fitness cache, the surrogate and
+// the phase times have nothing to work on - the EA refuses them.
+struct SteadyStateEA : public AbstractEA {
+	SteadyStateEA(size_t popSize, const Net &mother, const Drone &father, size_t workerCount = std::thread::hardware_concurrency())
+		: AbstractEA(popSize, mother, father), workerCount(std::max<size_t>(1, workerCount)), slotLocks(new std::mutex[popSize]) {
+		initPop(mother);
+		initAgents(father);
+
+		evaluatedIn.resize(popSize, 0);
+	}
+
+	~SteadyStateEA() override {
+		stopFlag = true;
+
+		for (auto && w : workers) {
+			w.join();
+		}
+	}
+
+	bool update(const float dt, const World &world, bool debug=false) override {
+		// worlds are told apart by content - a level randomized in place is a new world
+		const uint64_t key = hashWorld(world);
+		if (worldVersion == 0 || key != worldKey) {
+			std::lock_guard<std::mutex> lock(worldLock);
+			currentWorld = world;
+			worldKey = key;
+			worldVersion += 1;
+			// the workers start over with the evaluation of every slot
+			nextInitial = 0;
+		}
+
+		if (workers.empty()) {
+			assert(racing == RacingMode::Off && "SteadyStateEA has no shared episode to race drones in");
+			assert(!fitnessCache && "SteadyStateEA evaluates every genome once, there is nothing to cache");
+			assert(!surrogate && "SteadyStateEA can't pre-screen, its offspring are evaluated one by one");
+			assert(!timePhases && "SteadyStateEA has no generation episodes to time (telemetry is generational EAs only)");
+
+			for (int w = 0; w < workerCount; ++w) {
+				workers.emplace_back(&SteadyStateEA::workerLoop, this);
+			}
+		}
+
+		epochTarget = (generation + 1) * popSize;
+
+		std::unique_lock<std::mutex> lock(epochLock);
+		// timeout guards against a notification slipping between the check and the wait
+		while (evaluations.load() < epochTarget.load()) {
+			epochSignal.wait_for(lock, std::chrono::milliseconds(10));
+		}
+
+		// ask for process
+		return true;
+	}
+
+	void process() override {
+		if (verbose) std::cout << "SteadyStateEA Process" << std::endl;
+
+		fitnessAgents();
+
+		generation += 1;
+	}
+
+	std::vector<Weights> emigrants(size_t n) const override {
+		auto order = rankedSlots();
+		n = std::min(n, order.size());
+
+		std::vector<Weights> best;
+		best.reserve(n);
+		for (int i = 0; i < n; ++i) {
+			std::lock_guard<std::mutex> lock(slotLocks[order[i]]);
+			best.push_back(populationW[order[i]]);
+		}
+
+		return best;
+	}
+
+	// migrants are evaluated by the workers and compete for a slot like any offspring
+	void immigrate(const std::vector<Weights> &migrants) override {
+		std::lock_guard<std::mutex> lock(migrantLock);
+		pendingMigrants.insert(pendingMigrants.end(), migrants.begin(), migrants.end());
+		migrantsWaiting = true;
+	}
+
+	std::string typeName() const override {
+		return "SteadyStateEA";
+	}
+
+	// the workers can't be replayed, but the epoch accounting has to continue from the restored generation
+	void loadState(const json &state) override {
+		AbstractEA::loadState(state);
+
+		evaluations = generation * popSize;
+		epochTarget = generation * popSize;
+	}
+
+	void takeSnapshot(EASnapshot &snap, const bool withState = true) const override {
+		fillSnapshotInfo(snap, withState);
+
+		for (int i = 0; i < popSize; ++i) {
+			std::lock_guard<std::mutex> lock(slotLocks[i]);
+			std::copy(populationW[i].begin(), populationW[i].end(), snap.genome(i));
+		}
+	}
+
+	void saveProcedure(const std::string &path) const override {
+		json popW;
+
+		for (int i = 0; i < popSize; ++i) {
+			std::lock_guard<std::mutex> lock(slotLocks[i]);
+			popW[std::to_string(i)] = populationW[i];
+		}
+
+        json config = {
+			{"type", "SteadyStateEA"},
+            {"popSize", popSize},
+            {"motherNet", motherDescription},
+			{"popW", popW}
+        };
+
+        std::ofstream file(path);
+        file << config.dump(4);
+        file.close();
+
+		std::cout << "SteadyStateEA saved to a file: " << path << std::endl;
+	}
+
+private:
+	const size_t workerCount;
+	std::vector<std::thread> workers;
+	std::atomic<bool> stopFlag = false;
+
+	// fine-grained locking - one mutex per population slot
+	std::unique_ptr<std::mutex[]> slotLocks;
+	std::vector<uint64_t> evaluatedIn; // world version of the slot's fitness, 0 = never evaluated (guarded by the slot lock)
+
+	std::atomic<size_t> nextInitial = 0;
+	std::atomic<uint64_t> evaluations = 0;
+	std::atomic<uint64_t> epochTarget = 0;
+
+	std::mutex epochLock;
+	std::condition_variable epochSignal;
+
+	uint64_t worldKey = 0;
+	std::mutex worldLock;
+	World currentWorld;
+	std::atomic<uint64_t> worldVersion = 0;
+
+	std::mutex migrantLock;
+	std::vector<Weights> pendingMigrants;
+	std::atomic<bool> migrantsWaiting = false;
+
+	// stats of the current population (not used for any selection)
+	std::vector<size_t> fitnessAgents() override {
+		std::vector<float> snapshot(popSize);
+		float fitnessSum = 0;
+
+		for (int i = 0; i < popSize; ++i) {
+			std::lock_guard<std::mutex> lock(slotLocks[i]);
+			snapshot[i] = fitness[i];
+			fitnessSum += fitness[i];
+		}
+
+		std::vector<size_t> idx(popSize);
+		std::iota(idx.begin(), idx.end(), 0);
+		std::sort(idx.begin(), idx.end(), [&](size_t a, size_t b){return snapshot[a] > snapshot[b];});
+
+		lastFitnessStats.max = snapshot[idx[0]];
+		lastFitnessStats.min = snapshot[idx[popSize-1]];
+		lastFitnessStats.med = snapshot[idx[popSize/2]];
+		lastFitnessStats.avg = fitnessSum / popSize;
+
+		return idx;
+	}
+
+	std::vector<size_t> rankedSlots() const {
+		std::vector<float> snapshot(popSize);
+		for (int i = 0; i < popSize; ++i) {
+			std::lock_guard<std::mutex> lock(slotLocks[i]);
+			snapshot[i] = fitness[i];
+		}
+
+		std::vector<size_t> idx(popSize);
+		std::iota(idx.begin(), idx.end(), 0);
+		std::sort(idx.begin(), idx.end(), [&](size_t a, size_t b){return snapshot[a] > snapshot[b];});
+
+		return idx;
+	}
+
+	void workerLoop() {
+		// every worker simulates on its own net/drone/world copy
+		Net net;
+		const Net &mother = *population[0];
+		for (const auto & mod : mother.modules) {
+			net.modules.push_back(mod->clone());
+		}
+		net.input_size = mother.input_size;
+
+		Drone drone(agents[0]->startPos);
+
+		std::vector<float> observation;
+		observation.resize(input_size);
+
+		World world;
+		uint64_t seenWorldVersion = 0;
+
+		Weights candidate;
+
+		auto syncWorld = [&] {
+			if (worldVersion.load() != seenWorldVersion) {
+				std::lock_guard<std::mutex> lock(worldLock);
+				world = currentWorld;
+				seenWorldVersion = worldVersion.load();
+			}
+		};
+
+		while (!stopFlag) {
+			syncWorld();
+
+			bool counts = true;
+			const size_t initial = nextInitial.fetch_add(1);
+			if (initial < popSize) {
+				// evaluates the population in place - the first pass and after every world change
+				{
+					std::lock_guard<std::mutex> lock(slotLocks[initial]);
+					candidate = populationW[initial];
+					counts = evaluatedIn[initial] == 0;
+				}
+
+				net.loadWeights(candidate);
+				float f;
+				// a world change during the episode makes the result stale - evaluate the slot again
+				do {
+					syncWorld();
+					f = evaluateEpisode(net, drone, world, observation, controlPeriod);
+				} while (seenWorldVersion != worldVersion.load() && !stopFlag);
+
+				{
+					std::lock_guard<std::mutex> lock(slotLocks[initial]);
+					fitness[initial] = f;
+					evaluatedIn[initial] = seenWorldVersion;
+				}
+			}
+			else {
+				if (!takeMigrant(candidate)) {
+					breed(candidate);
+				}
+
+				net.loadWeights(candidate);
+				const float f = evaluateEpisode(net, drone, world, observation, controlPeriod);
+
+				replace(candidate, f, seenWorldVersion);
+			}
+
+			if (counts && evaluations.fetch_add(1) + 1 >= epochTarget.load()) {
+				epochSignal.notify_one();
+			}
+		}
+	}
+
+	bool takeMigrant(Weights &candidate) {
+		if (!migrantsWaiting) return false;
+
+		std::lock_guard<std::mutex> lock(migrantLock);
+		if (pendingMigrants.empty()) return false;
+
+		candidate = std::move(pendingMigrants.back());
+		pendingMigrants.pop_back();
+		migrantsWaiting = !pendingMigrants.empty();
+
+		return true;
+	}
+
+	// reads a slot, unevaluated (or stale) slots lose every comparison
+	float slotFitness(size_t id) const {
+		std::lock_guard<std::mutex> lock(slotLocks[id]);
+		return (evaluatedIn[id] == worldVersion.load()) ? fitness[id] : std::numeric_limits<float>::lowest();
+	}
+
+	size_t tournament(bool best) const {
+		std::uniform_int_distribution<std::mt19937::result_type> distr(0, popSize - 1);
+		const int tournamentSize = 2;
+
+		size_t bestId = distr(gen);
+		float bestFitness = slotFitness(bestId);
+		for (int x = 1; x < tournamentSize; ++x) {
+			size_t id = distr(gen);
+			float f = slotFitness(id);
+			if (best ? (f > bestFitness) : (f < bestFitness)) {
+				bestFitness = f;
+				bestId = id;
+			}
+		}
+
+		return bestId;
+	}
+
+	// uniform crossover of two tournament winners + cauchy mutation (as in CoSyNE)
+	void breed(Weights &offspring) {
+		const size_t p1 = tournament(true);
+		const size_t p2 = tournament(true);
+
+		{
+			std::lock_guard<std::mutex> lock(slotLocks[p1]);
+			offspring = populationW[p1];
+		}
+
+		std::uniform_real_distribution<float> chanceDistr(0.0f, 1.0f);
+		std::cauchy_distribution<float> perturbedDistr(0, 0.3);
+		const float MUTPROB = 0.05f;
+
+		{
+			std::lock_guard<std::mutex> lock(slotLocks[p2]);
+			for (int k = 0; k < offspring.size(); ++k) {
+				if (chanceDistr(gen) < 0.5) {
+					offspring[k] = populationW[p2][k];
+				}
+			}
+		}
+
+		for (int k = 0; k < offspring.size(); ++k) {
+			offspring[k] += ((chanceDistr(gen) < MUTPROB) ? perturbedDistr(gen) : 0.0f);
+		}
+	}
+
+	// offspring takes the place of a tournament loser if it is better (on the same world)
+	void replace(Weights &offspring, const float f, const uint64_t version) {
+		// evaluated on a world that is gone already - the fitness compares to nothing
+		if (version != worldVersion.load()) return;
+
+		const size_t loser = tournament(false);
+
+		std::lock_guard<std::mutex> lock(slotLocks[loser]);
+		// the slot could have changed since the tournament - check again under the lock
+		if (evaluatedIn[loser] != version || f > fitness[loser]) {
+			std::swap(populationW[loser], offspring);
+			fitness[loser] = f;
+			evaluatedIn[loser] = version;
+		}
+	}
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "net.hpp"
+
+struct SurrogateConfig {
+	size_t k = 5;                  // neighbours of a prediction
+	float simulateFraction = 0.5f; // best predicted part of the population that gets simulated
+	size_t historySize = 1024;     // evaluated genomes remembered (ring buffer, oldest get overwritten)
+	size_t minHistory = 256;       // no screening until the model has seen this many genomes
+};
+
+struct SurrogateStats {
+	uint64_t simulated = 0;
+	uint64_t imputed = 0;
+	float meanAbsError = 0; // of the predictions for the simulated individuals
+};
+
+// Cheap genome -> fitness model for pre-screening offspring.
+// Inverse-distance weighted kNN over the most recently evaluated genomes - offspring
+// are small perturbations of their parents, so their neighbours in weight space are
+// mostly their own ancestors. Training is just adding the newly evaluated genomes.
+struct Surrogate {
+	const SurrogateConfig config;
+
+	Surrogate(const SurrogateConfig &config) : config(config) {
+		assert(config.k > 0 && "Surrogate needs at least one neighbour");
+	}
+
+	size_t size() const {
+		return fitness.size();
+	}
+
+	bool ready() const {
+		return size() >= std::max(config.minHistory, config.k);
+	}
+
+	void add(const Weights &genome, const float f) {
+		if (dims == 0) {
+			dims = genome.size();
+			genomes.resize(dims * config.historySize);
+		}
+		assert(genome.size() == dims && "Surrogate genomes have to be of the same size");
+
+		if (size() < config.historySize) {
+			fitness.push_back(f);
+		}
+		else {
+			fitness[next] = f;
+		}
+
+		for (size_t d = 0; d < dims; ++d) {
+			genomes[d*config.historySize + next] = genome[d];
+		}
+		next = (next + 1) % config.historySize;
+	}
+
+	float predict(const Weights &genome) const {
+		assert(ready() && "Surrogate asked for a prediction before it has enough history");
+
+		const size_t n = size();
+
+		// dimension by dimension over the whole history - the inner loop has no
+		// reduction in it, so it vectorizes without -ffast-math
+		std::vector<float> dist(n, 0.0f);
+		for (size_t d = 0; d < dims; ++d) {
+			const float q = genome[d];
+			const float *column = &genomes[d*config.historySize];
+
+			for (size_t h = 0; h < n; ++h) {
+				const float diff = q - column[h];
+				dist[h] += diff*diff;
+			}
+		}
+
+		// max-heap of the k nearest (squared distance, history index)
+		std::vector<std::pair<float, size_t>> best;
+		best.reserve(config.k + 1);
+
+		for (size_t h = 0; h < n; ++h) {
+			if (best.size() < config.k) {
+				best.emplace_back(dist[h], h);
+				std::push_heap(best.begin(), best.end());
+			}
+			else if (dist[h] < best.front().first) {
+				std::pop_heap(best.begin(), best.end());
+				best.back() = {dist[h], h};
+				std::push_heap(best.begin(), best.end());
+			}
+		}
+
+		float weightSum = 0;
+		float prediction = 0;
+		for (auto && [d2, h] : best) {
+			// an exact match (unchanged elite) just gets its last known fitness
+			if (d2 == 0) return fitness[h];
+
+			const float w = 1.0f / std::sqrt(d2);
+			weightSum += w;
+			prediction += w * fitness[h];
+		}
+
+		return prediction / weightSum;
+	}
+
+	// only the scalars - the history itself goes to a checkpoint as raw float blocks
+	json saveState() const {
+		return json{{"dims", dims}, {"next", next}};
+	}
+
+	void saveHistory(std::vector<float> &genomesOut, std::vector<float> &fitnessOut) const {
+		genomesOut.assign(genomes.begin(), genomes.end());
+		fitnessOut.assign(fitness.begin(), fitness.end());
+	}
+
+	void loadState(const json &state) {
+		dims = state["dims"];
+		next = state["next"];
+	}
+
+	void loadHistory(std::span<const float> genomesIn, std::span<const float> fitnessIn) {
+		if (genomesIn.size() != dims * config.historySize || fitnessIn.size() > config.historySize || next >= config.historySize) {
+			throw std::runtime_error("Checkpoint surrogate history does not match the surrogate config");
+		}
+		genomes.assign(genomesIn.begin(), genomesIn.end());
+		fitness.assign(fitnessIn.begin(), fitnessIn.end());
+	}
+
+private:
+	size_t dims = 0;
+	size_t next = 0;
+
+	std::vector<float> genomes; // transposed - historySize floats per weight
+	std::vector<float> fitness;
+};
@@ -0,0 +1,368 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "BS_thread_pool.hpp"
+#include "cosyne.hpp"
+#include "drone.hpp"
+#include "ea.hpp"
+#include "easyea.hpp"
+#include "runner.hpp"
+#include "steadystate.hpp"
+#include "utils.hpp"
+
+// Every combination of the listed values is one configuration, each configuration runs `runs` times.
+// An empty list keeps the EA's own default for that parameter.
+struct SweepGrid {
+	std::vector<std::string> eaTypes{"cosyne"}; // 'easyea', 'cosyne', 'steady'
+	std::vector<size_t> popSizes{128};
+	std::vector<float> mutationProbs{0.01f, 0.05f, 0.1f}; // EasyEA, CoSyNE
+	std::vector<float> mutationScales{0.1f, 0.3f, 1.0f};  // CoSyNE (Cauchy scale)
+	std::vector<float> parentFractions{0.25f};            // CoSyNE
+	size_t runs = 5;
+	int generations = 500;
+
+	// run k of the sweep (config * runs + run) is seeded with seed + k, whatever thread it lands on
+	// (generational EAs repeat exactly, steady-state workers have generators of their own)
+	uint64_t seed = 1;
+	size_t threads = 0; // 0 = every core
+	std::string outDir = "fits/sweep";
+
+	// grid file - the keys are the fields above, missing ones keep their defaults:
+	//   {"eaTypes": ["easyea", "cosyne"], "popSizes": [64, 128, 256], "mutationScales": [], "runs": 10}
+	static SweepGrid load(const std::string &path) {
+		std::ifstream file(path);
+		if (!file) {
+			throw std::runtime_error("Cannot open sweep grid: " + path);
+		}
+		const json config = json::parse(file);
+
+		SweepGrid grid;
+		const std::vector<std::string> keys{"eaTypes", "popSizes", "mutationProbs", "mutationScales", "parentFractions",
+											"runs", "generations", "seed", "threads", "outDir"};
+		// a typo would otherwise silently sweep the defaults
+		for (auto && [key, value] : config.items()) {
+			if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+				throw std::runtime_error("Unknown sweep grid key '" + key + "' in " + path);
+			}
+		}
+
+		auto read = [&](const char *key, auto &field) {
+			if (config.contains(key)) field = config[key].get<std::decay_t<decltype(field)>>();
+		};
+		read("eaTypes", grid.eaTypes);
+		read("popSizes", grid.popSizes);
+		read("mutationProbs", grid.mutationProbs);
+		read("mutationScales", grid.mutationScales);
+		read("parentFractions", grid.parentFractions);
+		read("runs", grid.runs);
+		read("generations", grid.generations);
+		read("seed", grid.seed);
+		read("threads", grid.threads);
+		read("outDir", grid.outDir);
+
+		return grid;
+	}
+};
+
+// one point of the grid, negative = the EA's default
+struct SweepConfig {
+	std::string eaType;
+	size_t popSize = 0;
+	float mutationProb = -1;
+	float mutationScale = -1;
+	float parentFraction = -1;
+
+	// the EA with the parameters applied, generated from the calling thread's RNG
+	std::unique_ptr<AbstractEA> create(const Net &mother, const Drone &father) const {
+		if (eaType == "easyea") {
+			auto ea = std::make_unique<EasyEA>(popSize, mother, father);
+			if (mutationProb >= 0) ea->mutationProb = mutationProb;
+			return ea;
+		}
+		if (eaType == "steady") {
+			// one worker - the sweep already keeps every core busy
+			return std::make_unique<SteadyStateEA>(popSize, mother, father, 1);
+		}
+
+		auto ea = std::make_unique<CoSyNE>(popSize, mother, father);
+		if (mutationProb >= 0) ea->mutationProb = mutationProb;
+		if (mutationScale >= 0) ea->mutationScale = mutationScale;
+		if (parentFraction >= 0) ea->parentFraction = parentFraction;
+		return ea;
+	}
+
+	// cosyne_128_0.050000_0.300000_0.250000 - unset parameters print as "def"
+	std::string name() const {
+		return eaType + "_" + std::to_string(popSize) + "_" + value(mutationProb) + "_" + value(mutationScale) + "_" + value(parentFraction);
+	}
+
+private:
+	static std::string value(const float v) {
+		return (v < 0) ? "def" : std::to_string(v);
+	}
+};
+
+// Runs a whole grid in-process: every (configuration, run) pair is one task on a shared BS::thread_pool,
+// a thread that finishes a short run just takes the next one from the queue, so uneven run lengths
+// (popSize 512 next to 64, a steady-state EA next to CoSyNE) don't leave cores idle until the last
+// launch of a batch is done. The longest runs are queued first, the tail of the sweep is short ones.
+//
+//   <outDir>/<config>_run<k>.csv  gen,max,min,avg,med,    per run, the fits/*.csv format
+//   <outDir>/summary.csv          config,gen,runs,max_mean,max_std,avg_mean,avg_std,med_mean,level_mean
+//   <outDir>/final.csv            one line per configuration - stats of the last generation over its runs (-1 = EA default)
+//                                 and the level every run ended on (runs on different levels don't compare by fitness)
+//
+// The runs are silent and don't checkpoint, the per-run CSVs are the result.
+struct SweepRunner : public AbstractRunner {
+	// the mother is only read (by the EA constructors of the runs) and has to outlive run()
+	SweepRunner(const SweepGrid &grid, const Net &mother) : grid(grid), mother(mother) {
+		assert(grid.runs > 0 && "A sweep needs at least one run per configuration");
+		expandGrid();
+	}
+
+	void prepare(const std::vector<World> &levels) override {
+		currentLevel = 0;
+		worldLevels = levels;
+	}
+
+	// the grid builds its own EAs (a passed one is ignored), maxGen > 0 overrides grid.generations
+	void run(Drone &drone, std::unique_ptr<AbstractEA> ea, const int maxGen, const std::string &note) override {
+		const int generations = (maxGen > 0) ? maxGen : grid.generations;
+		assert(generations > 0 && "A sweep needs a generation budget");
+
+		std::filesystem::create_directories(grid.outDir);
+
+		results.assign(configs.size() * grid.runs, RunResult{});
+
+		// longest first - cost ~ popSize, the run index keeps the order stable
+		std::vector<size_t> order(results.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			return configs[a / grid.runs].popSize > configs[b / grid.runs].popSize;
+		});
+
+		BS::thread_pool<> pool(grid.threads);
+		printf("Sweep: %zu configurations x %zu runs, %d generations, %zu threads -> %s\n", configs.size(), grid.runs, generations,
+			   (size_t)pool.get_thread_count(), grid.outDir.c_str());
+
+		const auto start = std::chrono::steady_clock::now();
+		for (auto task : order) {
+			pool.detach_task([this, task, generations, &drone] { runTask(task, generations, drone); });
+		}
+
+		while (!pool.wait_for(std::chrono::seconds(5))) {
+			reportProcedure(start);
+		}
+
+		const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		double busy = 0;
+		for (auto && r : results) {
+			busy += r.seconds;
+		}
+
+		writeSummary();
+		printf("Sweep done: %zu runs in %.1f s --- core utilisation %.1f%% (%.1f s of runs on %zu threads)\n", results.size(), wall,
+			   100.0 * busy / (wall * pool.get_thread_count()), busy, (size_t)pool.get_thread_count());
+	}
+
+	const std::vector<SweepConfig> &configurations() const {
+		return configs;
+	}
+
+private:
+	struct RunResult {
+		std::vector<FitnessStats> stats; // one per generation
+		std::vector<int> levels;         // the level each generation was evaluated on
+		double seconds = 0;
+	};
+
+	const SweepGrid grid;
+	const Net &mother;
+
+	std::vector<SweepConfig> configs;
+	std::vector<RunResult> results; // config * runs + run, every task writes only its own slot
+	std::atomic<size_t> finished{0};
+
+	void expandGrid() {
+		// an empty list is a single "default" value
+		auto values = [](const std::vector<float> &list) {
+			return list.empty() ? std::vector<float>{-1} : list;
+		};
+
+		for (auto && type : grid.eaTypes) {
+			for (auto popSize : grid.popSizes) {
+				for (auto mp : values(grid.mutationProbs)) {
+					for (auto ms : values(grid.mutationScales)) {
+						for (auto pf : values(grid.parentFractions)) {
+							// parameters an EA doesn't have would only repeat the same configuration
+							configs.push_back(SweepConfig{
+								.eaType = type,
+								.popSize = popSize,
+								.mutationProb = (type == "steady") ? -1 : mp,
+								.mutationScale = (type == "cosyne") ? ms : -1,
+								.parentFraction = (type == "cosyne") ? pf : -1,
+							});
+						}
+					}
+				}
+			}
+		}
+
+		std::sort(configs.begin(), configs.end(), [](const SweepConfig &a, const SweepConfig &b) { return a.name() < b.name(); });
+		configs.erase(std::unique(configs.begin(), configs.end(), [](const SweepConfig &a, const SweepConfig &b) { return a.name() == b.name(); }),
+					  configs.end());
+	}
+
+	// one run on a pool thread - its own EA, RNG state and copy of the levels
+	void runTask(const size_t task, const int generations, const Drone &drone) {
+		const SweepConfig &config = configs[task / grid.runs];
+		const size_t run = task % grid.runs;
+		RunResult &result = results[task];
+
+		const auto start = std::chrono::steady_clock::now();
+
+		gen.seed(grid.seed + task);
+		std::unique_ptr<AbstractEA> ea = config.create(mother, drone);
+		ea->verbose = false;
+
+		std::vector<World> levels = worldLevels;
+		int level = 0;
+
+		result.stats.reserve(generations);
+		while (ea->generation < (uint64_t)generations)
+		{
+			if (!ea->update(dt, levels[level], false)) continue;
+
+			ea->process();
+			levels[level].randomize();
+			result.stats.push_back(ea->lastFitnessStats);
+			result.levels.push_back(level);
+
+			levelUpProcedure(*ea, level);
+		}
+
+		writeRun(config.name() + "_run" + std::to_string(run), result.stats);
+
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		finished.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void writeRun(const std::string &name, const std::vector<FitnessStats> &stats) const {
+		std::string text;
+		char line[256];
+		for (size_t g = 0; g < stats.size(); ++g) {
+			// same text as the telemetry log
+			const int n = std::snprintf(line, sizeof(line), "%lu,%f,%f,%f,%f,\n", (unsigned long)(g + 1), stats[g].max, stats[g].min, stats[g].avg, stats[g].med);
+			text.append(line, n);
+		}
+
+		std::ofstream file((std::filesystem::path(grid.outDir) / (name + ".csv")).string(), std::ios::trunc);
+		file << text;
+		if (!file) {
+			std::cout << "Sweep: cannot write the run " << name << std::endl;
+		}
+	}
+
+	void reportProcedure(const std::chrono::steady_clock::time_point &start) const {
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("[%.0fs] Sweep: %zu/%zu runs done\n", elapsed, finished.load(std::memory_order_relaxed), results.size());
+	}
+
+	static void meanStd(const std::vector<float> &values, double &mean, double &std) {
+		mean = 0;
+		for (auto v : values) mean += v;
+		mean /= values.size();
+
+		std = 0;
+		for (auto v : values) std += (v - mean) * (v - mean);
+		std = (values.size() > 1) ? std::sqrt(std / (values.size() - 1)) : 0;
+	}
+
+	void writeSummary() const {
+		std::ofstream summary((std::filesystem::path(grid.outDir) / "summary.csv").string(), std::ios::trunc);
+		std::ofstream last((std::filesystem::path(grid.outDir) / "final.csv").string(), std::ios::trunc);
+		summary << "config,gen,runs,max_mean,max_std,avg_mean,avg_std,med_mean,level_mean\n";
+		last << "config,ea,popSize,mutationProb,mutationScale,parentFraction,runs,max_mean,max_std,max_best,avg_mean,avg_std,seconds_mean,final_levels\n";
+
+		struct Row {
+			std::string name;
+			double maxMean, maxStd, avgMean, levelMean;
+		};
+		std::vector<Row> table;
+
+		char line[512];
+		std::vector<float> maxs, avgs, meds, levels;
+		for (size_t c = 0; c < configs.size(); ++c) {
+			const std::string name = configs[c].name();
+
+			size_t length = 0;
+			for (size_t r = 0; r < grid.runs; ++r) {
+				length = std::max(length, results[c * grid.runs + r].stats.size());
+			}
+
+			double maxMean = 0, maxStd = 0, avgMean = 0, avgStd = 0, medMean = 0, medStd = 0, levelMean = 0, levelStd = 0;
+			for (size_t g = 0; g < length; ++g) {
+				maxs.clear(); avgs.clear(); meds.clear(); levels.clear();
+				for (size_t r = 0; r < grid.runs; ++r) {
+					const auto &stats = results[c * grid.runs + r].stats;
+					if (g >= stats.size()) continue;
+					maxs.push_back(stats[g].max);
+					avgs.push_back(stats[g].avg);
+					meds.push_back(stats[g].med);
+					levels.push_back(results[c * grid.runs + r].levels[g]);
+				}
+
+				meanStd(maxs, maxMean, maxStd);
+				meanStd(avgs, avgMean, avgStd);
+				meanStd(meds, medMean, medStd);
+				meanStd(levels, levelMean, levelStd);
+
+				std::snprintf(line, sizeof(line), "%s,%zu,%zu,%f,%f,%f,%f,%f,%f\n", name.c_str(), g + 1, maxs.size(), maxMean, maxStd, avgMean, avgStd, medMean, levelMean);
+				summary << line;
+			}
+
+			// the loop ended on the last generation
+			float best = 0;
+			double seconds = 0;
+			std::string finalLevels; // 0;0;1 - the level of each run's last generation
+			for (size_t r = 0; r < grid.runs; ++r) {
+				const RunResult &result = results[c * grid.runs + r];
+				for (auto && s : result.stats) best = std::max(best, s.max);
+				seconds += result.seconds;
+				finalLevels += (r ? ";" : "") + std::to_string(result.levels.empty() ? 0 : result.levels.back());
+			}
+
+			const SweepConfig &config = configs[c];
+			std::snprintf(line, sizeof(line), "%s,%s,%zu,%f,%f,%f,%zu,%f,%f,%f,%f,%f,%f,%s\n", name.c_str(), config.eaType.c_str(), config.popSize,
+						  config.mutationProb, config.mutationScale, config.parentFraction, grid.runs, maxMean, maxStd, best, avgMean, avgStd,
+						  seconds / grid.runs, finalLevels.c_str());
+			last << line;
+
+			table.push_back(Row{name, maxMean, maxStd, avgMean, levelMean});
+		}
+
+		// further levels first - their fitness is lower but they got further
+		std::sort(table.begin(), table.end(), [](const Row &a, const Row &b) {
+			return (a.levelMean != b.levelMean) ? a.levelMean > b.levelMean : a.maxMean > b.maxMean;
+		});
+
+		printf("%-42s %8s %14s %12s %14s\n", "config (last generation)", "Lvl mean", "BF mean", "BF std", "AVGF mean");
+		for (auto && row : table) {
+			printf("%-42s %8.2f %14.3f %12.3f %14.3f\n", row.name.c_str(), row.levelMean, row.maxMean, row.maxStd, row.avgMean);
+		}
+	}
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "ea.hpp"
+
+// Per-generation log of a run, written on a background thread.
+//
+//   fits/<name>.csv          gen,max,min,avg,med,  - the format pics/statsplots_*.py read (no header)
+//   fits/phases/<name>.csv   gen,simulation,sensors,inference,selection,io  (seconds)
+//
+// The phase timings get their own directory, so the plot scripts never pick them up.
+// Lines are collected in memory and handed to the writer in batches (every `batchLines`
+// generations or `maxDelay`, whichever comes first), the run itself never waits on the disk.
+struct TelemetryLog {
+	using Clock = std::chrono::steady_clock;
+
+	const size_t batchLines;
+	const Clock::duration maxDelay;
+
+	TelemetryLog(const std::string &name, const size_t batchLines = 64, const Clock::duration maxDelay = std::chrono::seconds(5))
+		: batchLines(std::max<size_t>(1, batchLines)), maxDelay(maxDelay) {
+		std::filesystem::create_directories("fits/phases");
+
+		// appending to an earlier (resumed) run keeps its header
+		const std::string phasesPath = "fits/phases/" + name + ".csv";
+		if (!std::filesystem::exists(phasesPath) || std::filesystem::file_size(phasesPath) == 0) {
+			pendingPhases = "gen,simulation,sensors,inference,selection,io\n";
+		}
+
+		statsFile.open("fits/" + name + ".csv", std::ios::app);
+		phasesFile.open(phasesPath, std::ios::app);
+		if (!statsFile || !phasesFile) {
+			std::cout << "Telemetry: cannot open the logs of " << name << std::endl;
+		}
+
+		lastHandOver = Clock::now();
+		worker = std::thread(&TelemetryLog::writerLoop, this);
+	}
+
+	~TelemetryLog() {
+		handOver();
+		{
+			std::lock_guard<std::mutex> lock(queueLock);
+			stopFlag = true;
+		}
+		queueSignal.notify_all();
+		worker.join();
+	}
+
+	TelemetryLog(const TelemetryLog&) = delete;
+	TelemetryLog& operator=(const TelemetryLog&) = delete;
+
+	// called by the runner thread once per generation
+	void record(const AbstractEA &ea, const PhaseTimes &times) {
+		char line[256];
+
+		// %f is what std::to_string(float) prints - same text as the existing fits/*.csv
+		int n = std::snprintf(line, sizeof(line), "%lu,%f,%f,%f,%f,\n", (unsigned long)ea.generation,
+							  ea.lastFitnessStats.max, ea.lastFitnessStats.min, ea.lastFitnessStats.avg, ea.lastFitnessStats.med);
+		pendingStats.append(line, n);
+
+		n = std::snprintf(line, sizeof(line), "%lu,%.6f,%.6f,%.6f,%.6f,%.6f\n", (unsigned long)ea.generation,
+						  times.simulation, times.sensors, times.inference, times.selection, times.io);
+		pendingPhases.append(line, n);
+
+		pendingLines += 1;
+		if (pendingLines >= batchLines || Clock::now() - lastHandOver >= maxDelay) {
+			handOver();
+		}
+	}
+
+	// hands the pending lines over and waits until they are written
+	void flush() {
+		handOver();
+
+		std::unique_lock<std::mutex> lock(queueLock);
+		doneSignal.wait(lock, [&]{ return queuedStats.empty() && queuedPhases.empty() && !writing; });
+	}
+
+private:
+	std::ofstream statsFile;
+	std::ofstream phasesFile;
+
+	// runner side - not shared
+	std::string pendingStats;
+	std::string pendingPhases;
+	size_t pendingLines = 0;
+	Clock::time_point lastHandOver;
+
+	std::mutex queueLock;
+	std::condition_variable queueSignal; // new batch or stop
+	std::condition_variable doneSignal;  // a batch got written
+	std::string queuedStats;
+	std::string queuedPhases;
+	bool writing = false;
+	bool stopFlag = false;
+
+	std::thread worker;
+
+	// never blocks on the writer - a batch it has not picked up yet just grows
+	void handOver() {
+		lastHandOver = Clock::now();
+		if (pendingStats.empty() && pendingPhases.empty()) return;
+
+		{
+			std::lock_guard<std::mutex> lock(queueLock);
+			queuedStats += pendingStats;
+			queuedPhases += pendingPhases;
+		}
+		queueSignal.notify_one();
+
+		pendingStats.clear();
+		pendingPhases.clear();
+		pendingLines = 0;
+	}
+
+	void writerLoop() {
+		std::string stats, phases;
+
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(queueLock);
+				queueSignal.wait(lock, [&]{ return stopFlag || !queuedStats.empty() || !queuedPhases.empty(); });
+
+				// queued lines still get written on shutdown
+				if (queuedStats.empty() && queuedPhases.empty()) return;
+
+				stats.swap(queuedStats);
+				phases.swap(queuedPhases);
+				writing = true;
+			}
+
+			// one write + flush per batch, the files are readable while the run goes on
+			statsFile.write(stats.data(), stats.size());
+			statsFile.flush();
+			phasesFile.write(phases.data(), phases.size());
+			phasesFile.flush();
+
+			stats.clear();
+			phases.clear();
+
+			{
+				std::lock_guard<std::mutex> lock(queueLock);
+				writing = false;
+			}
+			doneSignal.notify_all();
+		}
+	}
+};
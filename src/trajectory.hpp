@@ -0,0 +1,478 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "drone.hpp"
+#include "spsc_queue.hpp"
+#include "utils.hpp"
+
+// Binary log of evaluated episodes - per-tick drone state of the best individuals of every generation.
+//
+// File layout (native byte order, byteOrder tells a foreign machine):
+//   TrajectoryFileHeader
+//   episodes, one after another:
+//     TrajectoryEpisodeHeader
+//     goalCount * 2 floats   goal positions of the episode's world
+//     wallCount * 3 floats   walls (x, y, radius)
+//     frameCount * TrajectoryFrame
+//
+// Episodes are appended, a resumed run continues the same log.
+struct TrajectoryFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t frameSize;
+	uint32_t episodeHeaderSize;
+	float dt;
+	uint8_t reserved[36];
+};
+static_assert(sizeof(TrajectoryFileHeader) == 64, "Trajectory file header has to stay 64 bytes");
+
+struct TrajectoryEpisodeHeader {
+	char magic[4];
+	uint32_t frameCount;
+	uint64_t generation;
+	uint32_t individual; // index in the population of that generation
+	uint32_t rank;       // 0 = best of the generation
+	float fitness;       // final objective fitness (goal bonus incl.)
+	uint16_t goalCount;
+	uint16_t wallCount;
+};
+static_assert(sizeof(TrajectoryEpisodeHeader) == 32, "Trajectory episode header has to stay 32 bytes");
+
+// drone state after one tick
+struct TrajectoryFrame {
+	float x, y;
+	float angle;
+	float thrusterAngle[2]; // left, right
+	float thrusterPower[2];
+	int8_t controls[4];     // net outputs (lac, lpc, rac, rpc) in [-1, 1], scaled by 127
+	uint16_t goalIndex;
+	uint16_t tick;
+
+	static TrajectoryFrame capture(const Drone &drone) {
+		TrajectoryFrame frame;
+		frame.x = drone.pos.x;
+		frame.y = drone.pos.y;
+		frame.angle = drone.angle;
+		frame.thrusterAngle[0] = drone.thrusterLeft.angle;
+		frame.thrusterAngle[1] = drone.thrusterRight.angle;
+		frame.thrusterPower[0] = drone.thrusterLeft.power;
+		frame.thrusterPower[1] = drone.thrusterRight.power;
+		for (int c = 0; c < 4; ++c) {
+			// rounded half away from zero (std::lround is a library call, this runs every tick)
+			const float scaled = std::clamp(drone.lastControls[c], -1.0f, 1.0f) * 127;
+			frame.controls[c] = static_cast<int8_t>(scaled + ((scaled < 0) ? -0.5f : 0.5f));
+		}
+		frame.goalIndex = static_cast<uint16_t>(std::min<size_t>(drone.goalIndex, 0xFFFF));
+		frame.tick = static_cast<uint16_t>(std::min<uint64_t>(drone.ticks, 0xFFFF));
+		return frame;
+	}
+
+	float control(const int c) const {
+		return controls[c] / 127.0f;
+	}
+
+	// puts the recorded state on a drone, enough for Renderer::draw_body (no physics state)
+	void apply(Drone &drone) const {
+		drone.pos = sf::Vector2f{x, y};
+		drone.angle = angle;
+		drone.control(control(0), control(1), control(2), control(3));
+		drone.thrusterLeft.angle = thrusterAngle[0];
+		drone.thrusterRight.angle = thrusterAngle[1];
+		drone.thrusterLeft.power = thrusterPower[0];
+		drone.thrusterRight.power = thrusterPower[1];
+		drone.goalIndex = goalIndex;
+		drone.ticks = tick;
+	}
+
+	// + goal collection highlight, same check as the collection in AbstractEA::stepAgent
+	void apply(Drone &drone, const World &world) const {
+		apply(drone);
+
+		const sf::Vector2f goalDist = world.goals[goalIndex % world.goals.size()] - drone.pos;
+		drone.goalTimer = (goalDist.x*goalDist.x + goalDist.y*goalDist.y < 100) ? 1 : 0;
+	}
+};
+static_assert(sizeof(TrajectoryFrame) == 36, "Trajectory frames have to stay 36 bytes");
+
+struct Trajectory {
+	static constexpr char magic[8] = {'G', 'B', 'D', 'T', 'R', 'A', 'J', '\0'};
+	static constexpr char episodeMagic[4] = {'E', 'P', 'S', '\0'};
+	static constexpr uint32_t version = 1;
+	static constexpr uint32_t byteOrderMark = 0x01020304;
+};
+
+struct TrajectoryConfig {
+	size_t bestCount = 4;      // best individuals of every generation that get written
+	size_t queueCapacity = 64; // episodes on their way to the writer, more get dropped
+};
+
+struct TrajectoryStats {
+	uint64_t episodes = 0; // handed to the writer
+	uint64_t dropped = 0;  // the writer was behind and the queue full
+	uint64_t bytes = 0;    // log size once everything handed over is written
+};
+
+// Records the episodes of a generational EA and writes the best of them on a background thread.
+//
+// Every simulated drone tick appends a frame to that individual's buffer (the buffers keep their
+// capacity, after the first generations no tick allocates). Once the fitness is known the best
+// bestCount episodes are handed to the writer through a lock-free SPSC ring, written episodes
+// come back through a second one for reuse. The EA never waits - with the ring full the episode
+// is dropped and counted.
+struct TrajectoryRecorder {
+	const TrajectoryConfig config;
+
+	TrajectoryRecorder(const std::string &path, const TrajectoryConfig &config, const size_t popSize)
+		: config(config), filled(std::max<size_t>(1, config.queueCapacity)), recycled(std::max<size_t>(1, config.queueCapacity)),
+		  live(popSize) {
+		assert(config.bestCount > 0 && "Trajectory recorder needs at least one episode per generation");
+
+		const std::filesystem::path parent = std::filesystem::path(path).parent_path();
+		if (!parent.empty()) std::filesystem::create_directories(parent);
+
+		file = std::fopen(path.c_str(), "ab");
+		if (!file) {
+			throw std::runtime_error("Cannot open trajectory log: " + path);
+		}
+
+		// appending to an earlier (resumed) run keeps its header
+		stats.bytes = std::filesystem::file_size(path);
+		if (stats.bytes == 0) {
+			TrajectoryFileHeader header{};
+			std::memcpy(header.magic, Trajectory::magic, sizeof(Trajectory::magic));
+			header.version = Trajectory::version;
+			header.byteOrder = Trajectory::byteOrderMark;
+			header.frameSize = sizeof(TrajectoryFrame);
+			header.episodeHeaderSize = sizeof(TrajectoryEpisodeHeader);
+			header.dt = dt;
+
+			std::fwrite(&header, sizeof(header), 1, file);
+			stats.bytes += sizeof(header);
+		}
+
+		worker = std::thread(&TrajectoryRecorder::writerLoop, this);
+	}
+
+	~TrajectoryRecorder() {
+		stopFlag = true;
+		worker.join();
+		std::fclose(file);
+	}
+
+	TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+	TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+	// first tick of a generation
+	void beginGeneration(const World &world) {
+		for (auto && frames : live) {
+			frames.clear();
+		}
+
+		worldData.clear();
+		for (auto && g : world.goals) {
+			worldData.insert(worldData.end(), {g.x, g.y});
+		}
+		for (auto && w : world.walls) {
+			worldData.insert(worldData.end(), {w.pos.x, w.pos.y, w.radius});
+		}
+		goalCount = world.goals.size();
+		wallCount = world.walls.size();
+	}
+
+	// called for every simulated tick of individual i
+	void capture(const uint32_t i, const Drone &drone) {
+		live[i].push_back(TrajectoryFrame::capture(drone));
+	}
+
+	// fitness - final objective fitness of the generation, individuals without frames
+	// (cached, imputed) are not candidates
+	void endGeneration(const uint64_t generation, const std::vector<float> &fitness) {
+		std::vector<uint32_t> candidates;
+		for (uint32_t i = 0; i < live.size(); ++i) {
+			if (!live[i].empty()) candidates.push_back(i);
+		}
+
+		const size_t count = std::min(config.bestCount, candidates.size());
+		std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+						  [&](uint32_t a, uint32_t b){ return fitness[a] > fitness[b]; });
+
+		for (size_t r = 0; r < count; ++r) {
+			const uint32_t i = candidates[r];
+
+			Record record;
+			recycled.pop(record);
+
+			std::memcpy(record.header.magic, Trajectory::episodeMagic, sizeof(Trajectory::episodeMagic));
+			record.header.frameCount = live[i].size();
+			record.header.generation = generation;
+			record.header.individual = i;
+			record.header.rank = r;
+			record.header.fitness = fitness[i];
+			record.header.goalCount = goalCount;
+			record.header.wallCount = wallCount;
+			record.world = worldData;
+
+			// the record takes the frames, the individual gets the record's old buffer
+			record.frames.swap(live[i]);
+			const uint64_t size = record.size();
+
+			if (!filled.push(std::move(record))) {
+				stats.dropped += 1;
+				continue;
+			}
+
+			stats.episodes += 1;
+			stats.bytes += size;
+		}
+	}
+
+	// blocks until everything handed over so far is written (and flushed)
+	void flush() {
+		while (written.load(std::memory_order_acquire) < stats.episodes) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	const TrajectoryStats& statistics() const {
+		return stats;
+	}
+
+private:
+	struct Record {
+		TrajectoryEpisodeHeader header{};
+		std::vector<float> world;
+		std::vector<TrajectoryFrame> frames;
+
+		uint64_t size() const {
+			return sizeof(header) + world.size() * sizeof(float) + frames.size() * sizeof(TrajectoryFrame);
+		}
+	};
+
+	std::FILE *file = nullptr;
+
+	// EA side -> writer, written records go back for reuse
+	SpscQueue<Record> filled;
+	SpscQueue<Record> recycled;
+
+	// EA side - not shared
+	std::vector<std::vector<TrajectoryFrame>> live;
+	std::vector<float> worldData;
+	size_t goalCount = 0;
+	size_t wallCount = 0;
+	TrajectoryStats stats;
+
+	std::atomic<uint64_t> written{0};
+	std::atomic<bool> stopFlag{false};
+	std::thread worker;
+
+	void writerLoop() {
+		Record record;
+		uint64_t count = 0;
+
+		while (true) {
+			// checked before the queue - whatever was handed over before the stop still gets written
+			const bool stopping = stopFlag.load();
+
+			bool any = false;
+			while (filled.pop(record)) {
+				std::fwrite(&record.header, sizeof(record.header), 1, file);
+				std::fwrite(record.world.data(), sizeof(float), record.world.size(), file);
+				std::fwrite(record.frames.data(), sizeof(TrajectoryFrame), record.frames.size(), file);
+
+				record.frames.clear();
+				recycled.push(std::move(record));
+
+				count += 1;
+				any = true;
+			}
+
+			if (any) {
+				std::fflush(file);
+				written.store(count, std::memory_order_release);
+			}
+
+			if (stopping) return;
+
+			// nobody to wake the writer up - the EA side never touches a lock
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+	}
+};
+
+// one episode of a mapped log
+struct TrajectoryEpisode {
+	TrajectoryEpisodeHeader header; // copied - episodes in the file are only 4-byte aligned
+	const float *worldData = nullptr;
+	const TrajectoryFrame *frames = nullptr;
+
+	size_t frameCount() const {
+		return header.frameCount;
+	}
+
+	// frame of a tick, the last one once the episode is over
+	const TrajectoryFrame& frame(const size_t tick) const {
+		return frames[std::min<size_t>(tick, header.frameCount - 1)];
+	}
+
+	// goals and walls the episode was flown in
+	World world() const {
+		World w{.boundary = sf::Vector2f{winWidth, winHeight}};
+		for (size_t g = 0; g < header.goalCount; ++g) {
+			w.goals.push_back(sf::Vector2f{worldData[2*g], worldData[2*g + 1]});
+		}
+
+		const float *walls = worldData + 2*header.goalCount;
+		for (size_t k = 0; k < header.wallCount; ++k) {
+			w.walls.push_back(Wall{sf::Vector2f{walls[3*k], walls[3*k + 1]}, walls[3*k + 2]});
+		}
+		return w;
+	}
+};
+
+// Read-only mapping of a trajectory log. The episodes get indexed on open, a log that is
+// still being written just ends at the last complete episode.
+struct TrajectoryView {
+	TrajectoryView(const std::string &path) {
+		fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("Cannot open trajectory log: " + path);
+		}
+
+		struct stat st;
+		if (::fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(TrajectoryFileHeader)) {
+			::close(fd);
+			throw std::runtime_error("Trajectory log too small: " + path);
+		}
+		size = st.st_size;
+
+		data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) {
+			::close(fd);
+			throw std::runtime_error("Cannot map trajectory log: " + path);
+		}
+
+		const TrajectoryFileHeader &h = *static_cast<const TrajectoryFileHeader*>(data);
+		if (std::memcmp(h.magic, Trajectory::magic, sizeof(Trajectory::magic)) != 0 ||
+			h.byteOrder != Trajectory::byteOrderMark ||
+			h.version != Trajectory::version ||
+			h.frameSize != sizeof(TrajectoryFrame) ||
+			h.episodeHeaderSize != sizeof(TrajectoryEpisodeHeader)) {
+			release();
+			throw std::runtime_error("Invalid or unsupported trajectory log: " + path);
+		}
+
+		index();
+	}
+
+	~TrajectoryView() {
+		release();
+	}
+
+	TrajectoryView(const TrajectoryView&) = delete;
+	TrajectoryView& operator=(const TrajectoryView&) = delete;
+
+	// in file order - generation by generation, best first
+	const std::vector<TrajectoryEpisode>& episodes() const {
+		return all;
+	}
+
+	// recorded generations, ascending
+	const std::vector<uint64_t>& generations() const {
+		return gens;
+	}
+
+	// episodes of a generation by rank (empty when it was not recorded)
+	std::vector<const TrajectoryEpisode*> generation(const uint64_t g) const {
+		std::vector<const TrajectoryEpisode*> out;
+		auto it = std::lower_bound(gens.begin(), gens.end(), g);
+		if (it == gens.end() || *it != g) return out;
+
+		for (size_t e = firstOf[it - gens.begin()]; e < all.size() && all[e].header.generation == g; ++e) {
+			out.push_back(&all[e]);
+		}
+		std::sort(out.begin(), out.end(), [](auto a, auto b){ return a->header.rank < b->header.rank; });
+		return out;
+	}
+
+private:
+	int fd = -1;
+	void *data = nullptr;
+	size_t size = 0;
+
+	std::vector<TrajectoryEpisode> all;
+	std::vector<uint64_t> gens;
+	std::vector<size_t> firstOf; // first episode of every generation in gens
+
+	const char* bytes() const {
+		return static_cast<const char*>(data);
+	}
+
+	void index() {
+		size_t offset = sizeof(TrajectoryFileHeader);
+
+		while (offset + sizeof(TrajectoryEpisodeHeader) <= size) {
+			TrajectoryEpisode episode;
+			std::memcpy(&episode.header, bytes() + offset, sizeof(episode.header));
+			if (std::memcmp(episode.header.magic, Trajectory::episodeMagic, sizeof(Trajectory::episodeMagic)) != 0) break;
+
+			const size_t worldFloats = 2*episode.header.goalCount + 3*episode.header.wallCount;
+			const size_t next = offset + sizeof(episode.header) + worldFloats * sizeof(float) + episode.header.frameCount * sizeof(TrajectoryFrame);
+			// torn tail - the writer is not done with it
+			if (next > size || episode.header.frameCount == 0) break;
+
+			episode.worldData = reinterpret_cast<const float*>(bytes() + offset + sizeof(episode.header));
+			episode.frames = reinterpret_cast<const TrajectoryFrame*>(episode.worldData + worldFloats);
+
+			// a resumed run can log a generation again - the newest episodes of it count.
+			// A generation's ranks are written in ascending order (0 = best), so a rank that is not above
+			// the previous one in the same generation means the run logged that generation once more
+			const uint64_t g = episode.header.generation;
+			if (gens.empty() || g > gens.back()) {
+				gens.push_back(g);
+				firstOf.push_back(all.size());
+			}
+			else if (g < gens.back() || episode.header.rank <= all.back().header.rank) {
+				rewind(g);
+				gens.push_back(g);
+				firstOf.push_back(all.size());
+			}
+
+			all.push_back(episode);
+			offset = next;
+		}
+	}
+
+	// drops everything from generation g on (the run went back to an earlier checkpoint)
+	void rewind(const uint64_t g) {
+		auto it = std::lower_bound(gens.begin(), gens.end(), g);
+		all.resize(firstOf[it - gens.begin()]);
+		firstOf.resize(it - gens.begin());
+		gens.erase(it, gens.end());
+	}
+
+	void release() {
+		if (data && data != MAP_FAILED) ::munmap(data, size);
+		if (fd >= 0) ::close(fd);
+		data = nullptr;
+		fd = -1;
+	}
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer - one writer publishes values, one reader always gets the newest.
+// Neither side ever blocks or waits for the other, values the reader was too slow for are skipped.
+// The writer fills the back slot and swaps it with the middle one, the reader swaps its front
+// slot with the middle one when something new got published.
+template <typename T>
+struct TripleBuffer {
+	TripleBuffer() = default;
+
+	TripleBuffer(const TripleBuffer &) = delete;
+	TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+	// writer side - fill this slot, then publish()
+	T& back() {
+		return slots[backIndex].value;
+	}
+
+	void publish() {
+		const uint8_t previous = middle.exchange(backIndex | dirtyBit, std::memory_order_acq_rel);
+		backIndex = previous & indexMask;
+	}
+
+	// reader side - true when front() changed to a newer value
+	bool update() {
+		if (!(middle.load(std::memory_order_relaxed) & dirtyBit)) return false;
+
+		const uint8_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+		frontIndex = previous & indexMask;
+		return true;
+	}
+
+	const T& front() const {
+		return slots[frontIndex].value;
+	}
+
+private:
+	static constexpr uint8_t indexMask = 0x3;
+	static constexpr uint8_t dirtyBit = 0x4; // middle holds a value the reader has not seen
+
+	// each slot on its own cache lines
+	struct Slot {
+		alignas(64) T value{};
+	};
+	Slot slots[3];
+
+	alignas(64) std::atomic<uint8_t> middle{1};
+	alignas(64) uint8_t backIndex = 0;  // writer only
+	alignas(64) uint8_t frontIndex = 2; // reader only
+};
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BS_thread_pool.hpp"
+#include "drone.hpp"
+#include "ea.hpp"
+#include "runner.hpp"
+#include "sweep.hpp"
+#include "utils.hpp"
+
+// Where the tuner samples configurations from. Probabilities and the Cauchy scale are sampled
+// log-uniformly (0.01 vs 0.02 matters as much as 0.1 vs 0.2), the parent fraction uniformly.
+// EasyEA's selection fraction is a compile-time constant (the upscaling needs 1/factor whole),
+// so the crossover/parent fraction is tuned for CoSyNE only.
+struct TunerSpace {
+	std::vector<std::string> eaTypes{"easyea", "cosyne"};
+	std::vector<size_t> popSizes{64, 128, 256};
+	std::pair<float, float> mutationProb{0.005f, 0.2f};
+	std::pair<float, float> mutationScale{0.05f, 1.0f};
+	std::pair<float, float> parentFraction{0.1f, 0.5f};
+
+	SweepConfig sample(std::mt19937 &rng) const {
+		auto pick = [&](auto &list) { return list[std::uniform_int_distribution<size_t>(0, list.size() - 1)(rng)]; };
+		auto logUniform = [&](const std::pair<float, float> &range) {
+			return std::exp(std::uniform_real_distribution<float>(std::log(range.first), std::log(range.second))(rng));
+		};
+
+		SweepConfig config{.eaType = pick(eaTypes), .popSize = pick(popSizes)};
+		config.mutationProb = logUniform(mutationProb);
+		if (config.eaType == "cosyne") {
+			config.mutationScale = logUniform(mutationScale);
+			config.parentFraction = std::uniform_real_distribution<float>(parentFraction.first, parentFraction.second)(rng);
+		}
+		return config;
+	}
+};
+
+// Hyperband (Li et al. 2018): brackets of successive halving. A bracket starts n configurations
+// on a small generation budget, keeps the best 1/eta of them and gives the survivors eta times
+// the generations, until the survivors reach maxGenerations. The brackets trade the number of
+// configurations for the length of their first look - the aggressive one finds good settings fast,
+// the last one (a plain race of a few full runs) protects the ones that start slowly.
+struct TunerConfig {
+	int minGenerations = 9;   // budget of the first rung of the most aggressive bracket
+	int maxGenerations = 243; // a survivor of the last rung gets this many generations in total
+	float eta = 3;            // keep the best 1/eta, eta x the budget for the next rung
+	bool hyperband = true;    // false - only the most aggressive bracket (plain successive halving)
+	size_t scoreWindow = 5;   // a trial's score is its mean best fitness over the last generations (of its current level)
+
+	uint64_t seed = 1;
+	size_t threads = 0; // 0 = every core
+	std::string outDir = "fits/tuner";
+};
+
+// Runs the Hyperband brackets one after another, the trials of a rung in parallel on one
+// BS::thread_pool. A surviving trial is not restarted - its EA keeps evolving from where the
+// previous rung stopped, the generations it already ran count towards the next budget.
+// Each trial carries its own RNG state, results don't depend on the thread a rung lands on.
+// Fitness of different levels is not comparable, trials are ranked by the level they reached first.
+//
+//   <outDir>/tuner.csv              bracket,rung,trial,config,generations,level,score,kept   - every rung decision
+//   <outDir>/trial<id>_<config>.csv gen,max,min,avg,med,                                - the fitness curve of a trial
+struct TunerRunner : public AbstractRunner {
+	// the mother is only read (by the EA constructors of the trials) and has to outlive run()
+	TunerRunner(const TunerConfig &config, const TunerSpace &space, const Net &mother) : config(config), space(space), mother(mother) {
+		assert(config.minGenerations > 0 && config.maxGenerations >= config.minGenerations && config.eta > 1 && "Invalid tuner budgets");
+	}
+
+	void prepare(const std::vector<World> &levels) override {
+		currentLevel = 0;
+		worldLevels = levels;
+	}
+
+	// the tuner builds its own EAs (a passed one is ignored), maxGen > 0 overrides config.maxGenerations
+	void run(Drone &drone, std::unique_ptr<AbstractEA> ea, const int maxGen, const std::string &note) override {
+		const int R = (maxGen > 0) ? maxGen : config.maxGenerations;
+		const int sMax = std::max(0, (int)std::floor(std::log((double)R / config.minGenerations) / std::log((double)config.eta) + 1e-9));
+
+		std::filesystem::create_directories(config.outDir);
+		log.open((std::filesystem::path(config.outDir) / "tuner.csv").string(), std::ios::trunc);
+		log << "bracket,rung,trial,config,generations,level,score,kept\n";
+
+		std::mt19937 sampler(config.seed);
+		BS::thread_pool<> pool(config.threads);
+
+		const auto start = std::chrono::steady_clock::now();
+		const Trial *best = nullptr;
+		uint64_t spent = 0;
+
+		for (int s = sMax; s >= (config.hyperband ? 0 : sMax); --s) {
+			const size_t n = std::ceil((sMax + 1.0) / (s + 1.0) * std::pow(config.eta, s));
+			const double firstBudget = R * std::pow(config.eta, -s);
+
+			printf("Tuner: bracket %d --- %zu configurations, %.0f -> %d generations\n", s, n, firstBudget, R);
+
+			std::vector<Trial*> alive;
+			for (size_t i = 0; i < n; ++i) {
+				trials.push_back(std::make_unique<Trial>());
+				Trial &t = *trials.back();
+				t.id = trials.size() - 1;
+				t.config = space.sample(sampler);
+				t.rng.seed(config.seed + 1 + t.id);
+				alive.push_back(&t);
+			}
+
+			for (int rung = 0; rung <= s; ++rung) {
+				const int budget = (rung == s) ? R : std::max(1, (int)std::lround(firstBudget * std::pow(config.eta, rung)));
+
+				for (auto t : alive) {
+					pool.detach_task([this, t, budget, &drone] { advance(*t, budget, drone); });
+				}
+				pool.wait();
+
+				std::stable_sort(alive.begin(), alive.end(), [](const Trial *a, const Trial *b) { return a->better(*b); });
+				const size_t keep = (rung == s) ? 0 : std::max<size_t>(1, std::floor(alive.size() / config.eta));
+
+				for (size_t i = 0; i < alive.size(); ++i) {
+					const Trial &t = *alive[i];
+					log << s << "," << rung << "," << t.id << "," << t.config.name() << "," << t.curve.size() << "," << t.scoreLevel << "," << t.score << "," << (i < keep) << "\n";
+				}
+				log.flush();
+
+				printf("    rung %d: %zu x %d generations --- best %s Lvl %d %.3f\n", rung, alive.size(), budget, alive[0]->config.name().c_str(),
+					   alive[0]->scoreLevel, alive[0]->score);
+
+				// the final rung reached the full budget - its winner competes with the other brackets'
+				if (rung == s && (!best || alive[0]->better(*best))) {
+					best = alive[0];
+				}
+
+				// dropped trials give their memory back, the curves stay
+				for (size_t i = keep; i < alive.size(); ++i) {
+					alive[i]->ea.reset();
+				}
+				alive.resize(keep);
+			}
+		}
+
+		for (auto && t : trials) {
+			spent += t->curve.size();
+			writeCurve(*t);
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("Tuner done: %zu configurations, %lu generations in %.1f s (a full run of each: %lu)\n", trials.size(), (unsigned long)spent, seconds,
+			   (unsigned long)(trials.size() * R));
+		if (best) {
+			printf("Best: %s --- Lvl %d score %.3f after %zu generations (trial %zu)\n", best->config.name().c_str(), best->scoreLevel, best->score,
+				   best->curve.size(), best->id);
+		}
+	}
+
+private:
+	struct Trial {
+		size_t id = 0;
+		SweepConfig config;
+		std::mt19937 rng;
+
+		std::unique_ptr<AbstractEA> ea;
+		std::vector<World> levels;
+		int level = 0;
+
+		std::vector<FitnessStats> curve; // lastFitnessStats of every generation so far
+		std::vector<int> curveLevel;     // the level each of them was evaluated on
+		int scoreLevel = 0;
+		float score = 0;
+
+		// (level, fitness) - a trial on a harder level is ahead whatever its raw fitness
+		bool better(const Trial &other) const {
+			return (scoreLevel != other.scoreLevel) ? scoreLevel > other.scoreLevel : score > other.score;
+		}
+	};
+
+	const TunerConfig config;
+	const TunerSpace space;
+	const Net &mother;
+
+	std::vector<std::unique_ptr<Trial>> trials;
+	std::ofstream log;
+
+	// evolves the trial up to `budget` generations in total, on a pool thread
+	void advance(Trial &t, const int budget, const Drone &drone) {
+		// the trial's generator stands in for the thread's while it runs
+		std::swap(gen, t.rng);
+
+		if (!t.ea) {
+			t.ea = t.config.create(mother, drone);
+			t.ea->verbose = false;
+			t.levels = worldLevels;
+		}
+
+		AbstractEA &ea = *t.ea;
+		while (ea.generation < (uint64_t)budget)
+		{
+			if (!ea.update(dt, t.levels[t.level], false)) continue;
+
+			ea.process();
+			t.levels[t.level].randomize();
+			t.curve.push_back(ea.lastFitnessStats);
+			t.curveLevel.push_back(t.level);
+
+			levelUpProcedure(ea, t.level);
+		}
+
+		std::swap(gen, t.rng);
+
+		// the best of a single generation is noisy (randomized levels, lucky mutants),
+		// the window only takes generations of the level the last one was evaluated on
+		t.scoreLevel = t.curveLevel.empty() ? 0 : t.curveLevel.back();
+		size_t window = 0;
+		float sum = 0;
+		for (size_t g = t.curve.size(); g-- > 0 && window < config.scoreWindow && t.curveLevel[g] == t.scoreLevel;) {
+			sum += t.curve[g].max;
+			window += 1;
+		}
+		t.score = sum / std::max<size_t>(1, window);
+	}
+
+	void writeCurve(const Trial &t) const {
+		std::string text;
+		char line[256];
+		for (size_t g = 0; g < t.curve.size(); ++g) {
+			const int n = std::snprintf(line, sizeof(line), "%lu,%f,%f,%f,%f,\n", (unsigned long)(g + 1), t.curve[g].max, t.curve[g].min, t.curve[g].avg, t.curve[g].med);
+			text.append(line, n);
+		}
+
+		std::ofstream((std::filesystem::path(config.outDir) / ("trial" + std::to_string(t.id) + "_" + t.config.name() + ".csv")).string(), std::ios::trunc) << text;
+	}
+};
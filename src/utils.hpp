@@ -5,7 +5,8 @@
 #include <random>
 #include <vector>
 
-inline std::mt19937 gen(time(nullptr));
+// per-thread generator so that islands/workers never share (and race on) one engine
+inline thread_local std::mt19937 gen(std::random_device{}());
 
 constexpr float HALF_PI = M_PI * 0.5f;
 
@@ -0,0 +1,367 @@
+#pragma once
+
+#include <SFML/Graphics/CircleShape.hpp>
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/RenderTexture.hpp>
+#include <SFML/OpenGL.hpp>
+#include <SFML/Window/ContextSettings.hpp>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "drone.hpp"
+#include "ea.hpp"
+#include "loader.hpp"
+#include "renderer.hpp"
+#include "trajectory.hpp"
+#include "utils.hpp"
+
+enum class FrameFormat {
+	Png, // <dir>/frame_000000.png, ...
+	Raw, // <dir>/frames.rgba - the frames back to back, 8-bit RGBA (ffmpeg -f rawvideo)
+};
+
+// Writes rendered frames on background threads. PNG compression is by far the slowest part
+// of an export, so PNG frames are encoded by several threads at once (every frame has its own
+// file, order does not matter). Raw frames go to one file and keep a single writer.
+// The queue is bounded - with `capacity` frames waiting submit() blocks until an encoder
+// catches up, the renderer can't pile up frames in memory.
+struct FrameEncoder {
+	const FrameFormat format;
+	const unsigned width;
+	const unsigned height;
+
+	FrameEncoder(const std::string &directory, const FrameFormat format, const unsigned width, const unsigned height,
+				 size_t threads = 0, const size_t capacity = 16)
+		: format(format), width(width), height(height), directory(directory), capacity(std::max<size_t>(1, capacity)) {
+		std::filesystem::create_directories(directory);
+
+		if (format == FrameFormat::Raw) {
+			raw = std::fopen(rawPath().c_str(), "wb");
+			if (!raw) {
+				throw std::runtime_error("Cannot open raw frame file: " + rawPath());
+			}
+			threads = 1;
+		}
+		else if (threads == 0) {
+			// hardware_concurrency() may be 0 (unknown)
+			threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+		}
+
+		for (size_t t = 0; t < threads; ++t) {
+			workers.emplace_back(&FrameEncoder::encoderLoop, this);
+		}
+	}
+
+	~FrameEncoder() {
+		{
+			std::lock_guard<std::mutex> lock(queueLock);
+			stopFlag = true;
+		}
+		queueSignal.notify_all();
+		for (auto && w : workers) {
+			w.join();
+		}
+
+		if (raw) std::fclose(raw);
+	}
+
+	FrameEncoder(const FrameEncoder&) = delete;
+	FrameEncoder& operator=(const FrameEncoder&) = delete;
+
+	std::string rawPath() const {
+		return (std::filesystem::path(directory) / "frames.rgba").string();
+	}
+
+	// a frame buffer (width * height * 4), reused once an encoder is done with it
+	std::vector<uint8_t> acquire() {
+		std::lock_guard<std::mutex> lock(queueLock);
+		if (spare.empty()) return std::vector<uint8_t>(size_t(width) * height * 4);
+
+		std::vector<uint8_t> pixels = std::move(spare.back());
+		spare.pop_back();
+		return pixels;
+	}
+
+	// frames are numbered in the order they are submitted
+	void submit(std::vector<uint8_t> &&pixels) {
+		assert(pixels.size() == size_t(width) * height * 4 && "Frame does not match the encoder size");
+		std::unique_lock<std::mutex> lock(queueLock);
+
+		if (queue.size() >= capacity) {
+			stalls += 1;
+			spaceSignal.wait(lock, [&]{ return queue.size() < capacity; });
+		}
+
+		queue.push_back(Job{submitted++, std::move(pixels)});
+		queueSignal.notify_one();
+	}
+
+	// blocks until every submitted frame is written
+	void finish() {
+		std::unique_lock<std::mutex> lock(queueLock);
+		spaceSignal.wait(lock, [&]{ return queue.empty() && busy == 0; });
+
+		if (raw) std::fflush(raw);
+	}
+
+	uint64_t frames() {
+		std::lock_guard<std::mutex> lock(queueLock);
+		return submitted;
+	}
+
+	// how many times the renderer had to wait for an encoder
+	uint64_t backPressureStalls() {
+		std::lock_guard<std::mutex> lock(queueLock);
+		return stalls;
+	}
+
+private:
+	const std::string directory;
+	const size_t capacity;
+	std::FILE *raw = nullptr;
+
+	struct Job {
+		uint64_t index;
+		std::vector<uint8_t> pixels;
+	};
+
+	std::mutex queueLock;
+	std::condition_variable queueSignal; // new frame or stop
+	std::condition_variable spaceSignal; // a slot got free / a frame got written
+	std::deque<Job> queue;
+	std::vector<std::vector<uint8_t>> spare;
+	size_t busy = 0;
+	uint64_t submitted = 0;
+	uint64_t stalls = 0;
+	bool stopFlag = false;
+
+	std::vector<std::thread> workers;
+
+	void encoderLoop() {
+		sf::Image image;
+		char name[32];
+
+		while (true) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(queueLock);
+				queueSignal.wait(lock, [&]{ return stopFlag || !queue.empty(); });
+
+				// submitted frames still get written on shutdown
+				if (queue.empty()) return;
+
+				job = std::move(queue.front());
+				queue.pop_front();
+				busy += 1;
+			}
+			spaceSignal.notify_all();
+
+			if (format == FrameFormat::Raw) {
+				std::fwrite(job.pixels.data(), 1, job.pixels.size(), raw);
+			}
+			else {
+				std::snprintf(name, sizeof(name), "frame_%06lu.png", (unsigned long)job.index);
+				image.create(width, height, job.pixels.data());
+				if (!image.saveToFile((std::filesystem::path(directory) / name).string())) {
+					std::cout << "Frame " << job.index << " could not be written" << std::endl;
+				}
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(queueLock);
+				busy -= 1;
+				if (spare.size() < capacity) spare.push_back(std::move(job.pixels));
+			}
+			spaceSignal.notify_all();
+		}
+	}
+};
+
+// The window runners' scene (walls, current goal, drones through Renderer) drawn into an
+// offscreen sf::RenderTexture - no window. SFML 2.5 still gets its OpenGL context from X11
+// on Linux, a machine without a display needs a virtual one (xvfb-run ./Drone render ...).
+struct HeadlessRenderer {
+	const unsigned width;
+	const unsigned height;
+
+	HeadlessRenderer(const unsigned width = winWidth, const unsigned height = winHeight) : width(width), height(height) {
+		sf::ContextSettings settings;
+		settings.antialiasingLevel = 4;
+		if (!texture.create(width, height, settings)) {
+			throw std::runtime_error("Cannot create the offscreen render texture (no OpenGL context)");
+		}
+
+		wallPrefab.setFillColor(sf::Color(55,55,55));
+
+		goalPrefab.setRadius(10);
+		goalPrefab.setOrigin(goalPrefab.getRadius(), goalPrefab.getRadius());
+		goalPrefab.setFillColor(sf::Color(240,190,4));
+	}
+
+	// one frame - drones[0] is drawn on top and its goal is shown
+	void draw(const World &world, const std::vector<const TrajectoryFrame*> &drones) {
+		texture.clear();
+
+		for (auto && w : world.walls) {
+			wallPrefab.setPosition(w.pos);
+			wallPrefab.setRadius(w.radius);
+			wallPrefab.setOrigin(w.radius,w.radius);
+
+			texture.draw(wallPrefab);
+		}
+
+		for (size_t d = drones.size(); d-- > 0;) {
+			drones[d]->apply(drone, world);
+			renderer.draw_body(&drone, &texture);
+		}
+
+		if (!drones.empty()) {
+			goalPrefab.setPosition(world.goals[drones[0]->goalIndex % world.goals.size()]);
+			texture.draw(goalPrefab);
+		}
+	}
+
+	// GPU -> pixels (RGBA, top row first), straight into the encoder's buffer - copyToImage()
+	// would allocate a whole sf::Image (and a staging copy) every frame
+	void read(std::vector<uint8_t> &pixels) {
+		const size_t row = size_t(width) * 4;
+		assert(pixels.size() == row * height && "Frame buffer does not match the renderer");
+
+		texture.display();
+		texture.setActive(true);
+
+		sf::Texture::bind(&texture.getTexture());
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		sf::Texture::bind(nullptr);
+
+		// render textures are stored bottom row first
+		for (size_t y = 0; y < height / 2; ++y) {
+			std::swap_ranges(pixels.begin() + y * row, pixels.begin() + (y + 1) * row, pixels.begin() + (height - 1 - y) * row);
+		}
+	}
+
+private:
+	sf::RenderTexture texture;
+	Renderer renderer;
+	sf::CircleShape wallPrefab;
+	sf::CircleShape goalPrefab;
+	Drone drone{droneStart};
+};
+
+// episode frames to draw - a recorded one or a fresh simulation
+struct FrameSpan {
+	const TrajectoryFrame *frames;
+	size_t count;
+};
+
+struct Video {
+	// the episodes are drawn together, tick by tick, until the longest one is over
+	// (finished ones stay at their last frame), returns the frame count
+	static uint64_t render(const World &world, const std::vector<FrameSpan> &episodes, HeadlessRenderer &renderer, FrameEncoder &encoder) {
+		size_t length = 0;
+		for (auto && e : episodes) {
+			length = std::max(length, e.count);
+		}
+
+		std::vector<const TrajectoryFrame*> frames(episodes.size());
+		for (size_t t = 0; t < length; ++t) {
+			for (size_t e = 0; e < episodes.size(); ++e) {
+				frames[e] = &episodes[e].frames[std::min(t, episodes[e].count - 1)];
+			}
+			renderer.draw(world, frames);
+
+			std::vector<uint8_t> pixels = encoder.acquire();
+			renderer.read(pixels);
+			encoder.submit(std::move(pixels));
+		}
+
+		return length;
+	}
+
+	// ./Drone render <save | log.traj> [out dir] [png|raw] [individual | generation]
+	// trajectory log - every recorded rank of the generation (-1 = the last one) over each other
+	// EA save       - a fresh episode of the individual (-1 = 0, the best) on the world
+	static bool exportFrames(const std::string &source, const std::string &outDir, const FrameFormat format, const long select,
+							 const World &world, const Drone &father) {
+		HeadlessRenderer renderer;
+		FrameEncoder encoder(outDir, format, renderer.width, renderer.height);
+
+		std::string origin;
+		uint64_t frames = 0;
+		const auto start = std::chrono::steady_clock::now();
+
+		if (isTrajectoryLog(source)) {
+			TrajectoryView log(source);
+			if (log.generations().empty()) {
+				std::cout << "Trajectory log " << source << " has no complete episode" << std::endl;
+				return false;
+			}
+
+			const uint64_t generation = (select < 0) ? log.generations().back() : select;
+			const std::vector<const TrajectoryEpisode*> episodes = log.generation(generation);
+			if (episodes.empty()) {
+				std::cout << "Generation " << generation << " is not in " << source << std::endl;
+				return false;
+			}
+
+			std::vector<FrameSpan> spans;
+			for (auto && e : episodes) {
+				spans.push_back(FrameSpan{e->frames, e->frameCount()});
+			}
+
+			origin = source + ", generation " + std::to_string(generation) + ", " + std::to_string(episodes.size()) + " ranks";
+			frames = render(episodes[0]->world(), spans, renderer, encoder);
+		}
+		else {
+			std::unique_ptr<AbstractEA> ea = Loader::loadEA(source, father);
+			const size_t individual = (select < 0) ? 0 : select;
+
+			const std::vector<TrajectoryFrame> episode = ea->recordEpisode(individual, world);
+
+			origin = source + ", individual " + std::to_string(individual);
+			frames = render(world, {FrameSpan{episode.data(), episode.size()}}, renderer, encoder);
+		}
+
+		encoder.finish();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		printf("Rendered %s: %lu frames (%ux%u) in %.2f s - %.1f fps, %.1fx real time, encoder stalls %lu\n", origin.c_str(),
+			   (unsigned long)frames, renderer.width, renderer.height, seconds, frames / seconds, frames * dt / seconds,
+			   (unsigned long)encoder.backPressureStalls());
+
+		if (format == FrameFormat::Raw) {
+			printf("ffmpeg -f rawvideo -pix_fmt rgba -s %ux%u -r %d -i %s -pix_fmt yuv420p video.mp4\n",
+				   renderer.width, renderer.height, (int)std::lround(1 / dt), encoder.rawPath().c_str());
+		}
+		else {
+			printf("ffmpeg -framerate %d -i %s/frame_%%06d.png -pix_fmt yuv420p video.mp4\n", (int)std::lround(1 / dt), outDir.c_str());
+		}
+
+		return true;
+	}
+
+private:
+	static bool isTrajectoryLog(const std::string &path) {
+		char head[sizeof(Trajectory::magic)] = {};
+		std::ifstream file(path, std::ios::binary);
+		file.read(head, sizeof(head));
+		return file.gcount() == sizeof(head) && std::memcmp(head, Trajectory::magic, sizeof(Trajectory::magic)) == 0;
+	}
+};